@@ -0,0 +1,425 @@
+#include "BatchRenderer.h"
+#include "GraphicsDevice.h"
+#include "GPUQueue.h"
+#include "GPUBuffer.h"
+#include "GPUMemoryManager.h"
+#include "ImageViewCache.h"
+#include "JobSystem.h"
+#include <chrono>
+
+BatchRenderer::BatchRenderer(GraphicsDevice* pDevice, JobSystem* pJobs, uint32_t concurrentJobs)
+{
+	this->pDevice = pDevice;
+	this->pJobs = pJobs;
+	GPU = pDevice->GetGPU();
+	pQueue = pDevice->GetGPUQueue(VK_QUEUE_GRAPHICS_BIT);
+
+	createRenderPass();
+
+	slots.resize(std::max(concurrentJobs, 1u));
+	for (Slot& slot : slots)
+		createSlot(slot);
+}
+
+BatchRenderer::~BatchRenderer()
+{
+}
+
+void BatchRenderer::Submit(RenderJob job)
+{
+	pendingJobs.push_back(std::move(job));
+}
+
+BatchRenderStats BatchRenderer::Run()
+{
+	BatchRenderStats stats{};
+	pQueue->ResetFrameStats();
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	while (true)
+	{
+		bool anyBusy = false;
+		bool submitted = false;
+
+		for (Slot& slot : slots)
+		{
+			if (slot.busy && retireSlot(slot))
+				stats.jobsCompleted++;
+
+			if (!slot.busy && !pendingJobs.empty())
+			{
+				slot.job = std::move(pendingJobs.front());
+				pendingJobs.pop_front();
+
+				recordJob(slot);
+				submitted = true;
+			}
+
+			anyBusy |= slot.busy;
+		}
+
+		if (!anyBusy && pendingJobs.empty())
+			break;
+
+		if (submitted)
+		{
+			pQueue->Flush(); //everything recorded this pass goes out in one vkQueueSubmit
+			continue;
+		}
+
+		//nothing to hand out, block on the oldest submission that hasn't been read back yet
+		Slot* pOldest = nullptr;
+		for (Slot& slot : slots)
+		{
+			if (slot.busy && !slot.encodeJob && (!pOldest || slot.timelineValue < pOldest->timelineValue))
+				pOldest = &slot;
+		}
+
+		if (pOldest)
+		{
+			pQueue->Wait(pOldest->timelineValue);
+		}
+		else
+		{
+			//gpu is idle, only encoding left
+			for (Slot& slot : slots)
+			{
+				if (slot.busy)
+				{
+					pJobs->Wait(slot.encodeJob);
+					break;
+				}
+			}
+		}
+	}
+
+	stats.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	stats.jobsPerSecond = stats.seconds > 0.0 ? stats.jobsCompleted / stats.seconds : 0.0;
+	stats.queueSubmitCalls = pQueue->GetFrameStats().queueSubmitCalls;
+
+	std::cout << "batch: " << stats.jobsCompleted << " jobs in " << stats.seconds << " s (" << stats.jobsPerSecond << " jobs/s, "
+		<< stats.queueSubmitCalls << " queue submits, " << slots.size() << " slots)" << std::endl;
+
+	return stats;
+}
+
+VkRenderPass BatchRenderer::GetRenderPass() const
+{
+	return renderPass;
+}
+
+VkFormat BatchRenderer::GetTargetFormat()
+{
+	return VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+std::vector<uint8_t> BatchRenderer::EncodeImage(ImageEncoding encoding, const uint8_t* pRGBA, uint32_t width, uint32_t height)
+{
+	std::vector<uint8_t> out;
+	size_t pixelCount = (size_t)width * height;
+
+	switch (encoding)
+	{
+		case ImageEncoding::PPM:
+		{
+			std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+			out.reserve(header.size() + pixelCount * 3);
+			out.insert(out.end(), header.begin(), header.end());
+
+			for (size_t i = 0; i < pixelCount; ++i)
+			{
+				out.push_back(pRGBA[i * 4 + 0]);
+				out.push_back(pRGBA[i * 4 + 1]);
+				out.push_back(pRGBA[i * 4 + 2]);
+			}
+			break;
+		}
+		case ImageEncoding::TGA:
+		{
+			uint8_t header[18] = {};
+			header[2] = 2; //uncompressed true color
+			header[12] = width & 0xFF;
+			header[13] = (width >> 8) & 0xFF;
+			header[14] = height & 0xFF;
+			header[15] = (height >> 8) & 0xFF;
+			header[16] = 32;
+			header[17] = 0x28; //8 alpha bits, top-left origin
+
+			out.reserve(sizeof(header) + pixelCount * 4);
+			out.insert(out.end(), header, header + sizeof(header));
+
+			for (size_t i = 0; i < pixelCount; ++i) //tga stores bgra
+			{
+				out.push_back(pRGBA[i * 4 + 2]);
+				out.push_back(pRGBA[i * 4 + 1]);
+				out.push_back(pRGBA[i * 4 + 0]);
+				out.push_back(pRGBA[i * 4 + 3]);
+			}
+			break;
+		}
+	}
+
+	return out;
+}
+
+void BatchRenderer::Destroy()
+{
+	for (Slot& slot : slots)
+	{
+		if (slot.busy)
+		{
+			pQueue->Wait(slot.timelineValue);
+			if (slot.encodeJob) pJobs->Wait(slot.encodeJob);
+		}
+
+		destroySlotTarget(slot);
+
+		slot.readbackBuffer->UnMap();
+		delete slot.readbackBuffer;
+		vkDestroyCommandPool(GPU, slot.commandPool, nullptr);
+	}
+	slots.clear();
+
+	vkDestroyRenderPass(GPU, renderPass, nullptr);
+}
+
+void BatchRenderer::createRenderPass()
+{
+	VkAttachmentDescription colorAttachment{};
+	colorAttachment.format = GetTargetFormat();
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; //straight into the readback copy
+
+	VkAttachmentReference colorAttachmentRef{};
+	colorAttachmentRef.attachment = 0;
+	colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorAttachmentRef;
+
+	//make the attachment writes visible to the copy that follows the pass
+	VkSubpassDependency dependency{};
+	dependency.srcSubpass = 0;
+	dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &colorAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = 1;
+	renderPassInfo.pDependencies = &dependency;
+
+	VULKAN_CALL_ERROR(vkCreateRenderPass(GPU, &renderPassInfo, nullptr, &renderPass), "failed to create batch render pass");
+}
+
+void BatchRenderer::createSlot(Slot& slot)
+{
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = pQueue->GetQueueFamily();
+	VULKAN_CALL_ERROR(vkCreateCommandPool(GPU, &poolInfo, nullptr, &slot.commandPool), "failed to create batch command pool");
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = slot.commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	VULKAN_CALL_ERROR(vkAllocateCommandBuffers(GPU, &allocInfo, &slot.commandBuffer), "failed to allocate batch command buffer");
+
+	slot.target = VK_NULL_HANDLE;
+	slot.targetMemory = nullptr;
+	slot.targetView = VK_NULL_HANDLE;
+	slot.framebuffer = VK_NULL_HANDLE;
+	slot.extent = {};
+
+	slot.readbackBuffer = nullptr;
+	slot.pReadback = nullptr;
+	slot.readbackSize = 0;
+
+	slot.timelineValue = 0;
+	slot.encodeJob = nullptr;
+	slot.busy = false;
+}
+
+void BatchRenderer::resizeSlot(Slot& slot, VkExtent2D extent)
+{
+	destroySlotTarget(slot);
+	slot.extent = extent;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = GetTargetFormat();
+	imageInfo.extent = { extent.width, extent.height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VULKAN_CALL_ERROR(vkCreateImage(GPU, &imageInfo, nullptr, &slot.target), "failed to create batch render target");
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(GPU, slot.target, &memoryRequirements);
+	slot.targetMemory = pDevice->GetMainGPUMemoryAllocator()->AllocateGPUMemory(memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	VULKAN_CALL(vkBindImageMemory(GPU, slot.target, slot.targetMemory->handle, 0));
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = slot.target;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = GetTargetFormat();
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	slot.targetView = pDevice->GetImageViewCache()->Acquire(viewInfo);
+
+	VkFramebufferCreateInfo framebufferInfo{};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = renderPass;
+	framebufferInfo.attachmentCount = 1;
+	framebufferInfo.pAttachments = &slot.targetView;
+	framebufferInfo.width = extent.width;
+	framebufferInfo.height = extent.height;
+	framebufferInfo.layers = 1;
+	VULKAN_CALL_ERROR(vkCreateFramebuffer(GPU, &framebufferInfo, nullptr, &slot.framebuffer), "failed to create batch framebuffer");
+
+	//readback only grows, a smaller job reuses the bigger buffer
+	VkDeviceSize readbackSize = (VkDeviceSize)extent.width * extent.height * 4;
+	if (readbackSize > slot.readbackSize)
+	{
+		if (slot.readbackBuffer)
+		{
+			slot.readbackBuffer->UnMap();
+			delete slot.readbackBuffer;
+		}
+
+		slot.readbackBuffer = new GPUBuffer(pDevice);
+		slot.readbackBuffer->Create((size_t)readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_SHARING_MODE_EXCLUSIVE, true);
+		slot.pReadback = (const uint8_t*)slot.readbackBuffer->Map();
+		slot.readbackSize = readbackSize;
+	}
+}
+
+void BatchRenderer::destroySlotTarget(Slot& slot)
+{
+	if (slot.target == VK_NULL_HANDLE)
+		return;
+
+	vkDestroyFramebuffer(GPU, slot.framebuffer, nullptr);
+	pDevice->GetImageViewCache()->Release(slot.targetView);
+	pDevice->GetImageViewCache()->ReleaseImage(slot.target);
+	vkDestroyImage(GPU, slot.target, nullptr);
+	pDevice->GetMainGPUMemoryAllocator()->ReleaseGPUMemory(slot.targetMemory->allocID);
+
+	slot.target = VK_NULL_HANDLE;
+	slot.targetView = VK_NULL_HANDLE;
+	slot.framebuffer = VK_NULL_HANDLE;
+}
+
+void BatchRenderer::recordJob(Slot& slot)
+{
+	VkExtent2D extent = { slot.job.width, slot.job.height };
+	if (extent.width != slot.extent.width || extent.height != slot.extent.height)
+		resizeSlot(slot, extent);
+
+	VULKAN_CALL(vkResetCommandPool(GPU, slot.commandPool, 0)); //slot is idle, its last submission has retired
+
+	VkCommandBuffer cmd = slot.commandBuffer;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VULKAN_CALL_ERROR(vkBeginCommandBuffer(cmd, &beginInfo), "failed to begin batch command buffer");
+
+	VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	VkRenderPassBeginInfo passInfo{};
+	passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	passInfo.renderPass = renderPass;
+	passInfo.framebuffer = slot.framebuffer;
+	passInfo.renderArea.offset = { 0, 0 };
+	passInfo.renderArea.extent = extent;
+	passInfo.clearValueCount = 1;
+	passInfo.pClearValues = &clearColor;
+	vkCmdBeginRenderPass(cmd, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	VkViewport viewport = { 0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f };
+	VkRect2D scissor = { { 0, 0 }, extent };
+	vkCmdSetViewport(cmd, 0, 1, &viewport); //only matters to pipelines that declare them dynamic
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+	if (slot.job.record)
+		slot.job.record(cmd, extent);
+
+	vkCmdEndRenderPass(cmd);
+
+	VkBufferImageCopy region{};
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageExtent = { extent.width, extent.height, 1 };
+	vkCmdCopyImageToBuffer(cmd, slot.target, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.readbackBuffer->GetBuffer(), 1, &region);
+
+	VkBufferMemoryBarrier hostBarrier{};
+	hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = slot.readbackBuffer->GetBuffer();
+	hostBarrier.offset = 0;
+	hostBarrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+
+	VULKAN_CALL_ERROR(vkEndCommandBuffer(cmd), "failed to end batch command buffer");
+
+	slot.timelineValue = pQueue->Submit(1, &cmd);
+	slot.encodeJob = nullptr;
+	slot.busy = true;
+}
+
+bool BatchRenderer::retireSlot(Slot& slot)
+{
+	if (!slot.encodeJob)
+	{
+		if (!pQueue->IsComplete(slot.timelineValue))
+			return false;
+
+		//readback landed, encoding and io run on a worker while the other slots keep the gpu busy
+		Slot* pSlot = &slot;
+		slot.encodeJob = pJobs->Schedule([pSlot]()
+		{
+			const RenderJob& job = pSlot->job;
+			std::vector<uint8_t> encoded = EncodeImage(job.encoding, pSlot->pReadback, job.width, job.height);
+
+			if (!job.outputPath.empty())
+			{
+				std::ofstream file(job.outputPath, std::ios::binary);
+				file.write((const char*)encoded.data(), encoded.size());
+			}
+
+			if (job.onComplete)
+				job.onComplete(encoded);
+		});
+	}
+
+	if (!pJobs->IsComplete(slot.encodeJob))
+		return false;
+
+	slot.encodeJob = nullptr;
+	slot.busy = false;
+	return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "includes.h"
+#include <functional>
+#include <deque>
+#include <memory>
+#include <string>
+
+class GraphicsDevice;
+class JobSystem;
+class GPUBuffer;
+class GPUQueue;
+struct GPUMemoryAllocation;
+struct JobCounter;
+typedef std::shared_ptr<JobCounter> JobHandle;
+
+enum class ImageEncoding
+{
+	PPM, //binary P6, rgb
+	TGA  //uncompressed 32 bit, top-left origin
+};
+
+struct RenderJob
+{
+	uint32_t width;
+	uint32_t height;
+
+	//records draws inside an already begun render pass, viewport/scissor are set to the full target
+	std::function<void(VkCommandBuffer cmd, VkExtent2D extent)> record;
+
+	std::string outputPath; //empty skips the file write
+	ImageEncoding encoding;
+
+	std::function<void(const std::vector<uint8_t>& encodedImage)> onComplete; //optional, runs on a job system worker
+};
+
+struct BatchRenderStats
+{
+	uint32_t jobsCompleted;
+	double   seconds;
+	double   jobsPerSecond;
+	uint32_t queueSubmitCalls;
+};
+
+//offline rendering throughput mode. keeps several jobs in flight on independent offscreen targets, each slot has its own
+//command pool, color target and readback buffer. readback mapping + encoding + file io run on the job system while the
+//gpu moves on to the next jobs
+class BatchRenderer
+{
+public:
+	BatchRenderer(GraphicsDevice* pDevice, JobSystem* pJobs, uint32_t concurrentJobs = 4);
+	~BatchRenderer();
+
+	void Submit(RenderJob job);
+	BatchRenderStats Run(); //returns once every submitted job is encoded and written
+
+	VkRenderPass GetRenderPass() const; //R8G8B8A8_UNORM, compatible with the headless GraphicsDevice render pass
+	static VkFormat GetTargetFormat();
+
+	static std::vector<uint8_t> EncodeImage(ImageEncoding encoding, const uint8_t* pRGBA, uint32_t width, uint32_t height);
+
+	void Destroy();
+private:
+	struct Slot
+	{
+		VkCommandPool commandPool;
+		VkCommandBuffer commandBuffer;
+
+		VkImage target;
+		GPUMemoryAllocation* targetMemory;
+		VkImageView targetView;
+		VkFramebuffer framebuffer;
+		VkExtent2D extent;
+
+		GPUBuffer* readbackBuffer;
+		const uint8_t* pReadback; //persistently mapped
+		VkDeviceSize readbackSize;
+
+		RenderJob job;
+		uint64_t timelineValue; //graphics queue point of the job's submission
+		JobHandle encodeJob;
+		bool busy;
+	};
+
+	GraphicsDevice* pDevice;
+	JobSystem* pJobs;
+	GPUQueue* pQueue;
+	VkDevice GPU;
+
+	VkRenderPass renderPass;
+	std::vector<Slot> slots;
+	std::deque<RenderJob> pendingJobs;
+
+	void createRenderPass();
+	void createSlot(Slot& slot);
+	void resizeSlot(Slot& slot, VkExtent2D extent); //slot must be idle
+	void destroySlotTarget(Slot& slot);
+	void recordJob(Slot& slot);
+	bool retireSlot(Slot& slot); //true once the slot is free again
+};
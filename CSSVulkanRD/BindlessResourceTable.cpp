@@ -0,0 +1,239 @@
+#include "BindlessResourceTable.h"
+#include "GraphicsDevice.h"
+#include "DeferredDeletionQueue.h"
+
+uint32_t BindlessResourceTable::SlotArray::Acquire()
+{
+	uint32_t index;
+	if (!freeSlots.empty())
+	{
+		index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		if (next >= capacity)
+			throw std::runtime_error("bindless table is full");
+		index = next++;
+	}
+
+	used++;
+	return index;
+}
+
+BindlessResourceTable::BindlessResourceTable(GraphicsDevice* pDevice, uint32_t maxImages, uint32_t maxSamplers, uint32_t maxStorageBuffers)
+{
+	this->pDevice = pDevice;
+	GPU = pDevice->GetGPU();
+
+	images = { maxImages, 0, {}, 0 };
+	samplers = { maxSamplers, 0, {}, 0 };
+	storageBuffers = { maxStorageBuffers, 0, {}, 0 };
+
+	setLayout = VK_NULL_HANDLE;
+	pool = VK_NULL_HANDLE;
+	set = VK_NULL_HANDLE;
+}
+
+BindlessResourceTable::~BindlessResourceTable()
+{
+}
+
+void BindlessResourceTable::Create()
+{
+	std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+	bindings[0] = { BINDLESS_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, images.capacity, VK_SHADER_STAGE_ALL, nullptr };
+	bindings[1] = { BINDLESS_SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER, samplers.capacity, VK_SHADER_STAGE_ALL, nullptr };
+	bindings[2] = { BINDLESS_STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageBuffers.capacity, VK_SHADER_STAGE_ALL, nullptr };
+
+	//unwritten slots are fine as long as shaders don't touch them, and registering never waits for the gpu
+	VkDescriptorBindingFlags bindingFlag = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+	std::array<VkDescriptorBindingFlags, 3> bindingFlags = { bindingFlag, bindingFlag, bindingFlag };
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	flagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+	flagsInfo.pBindingFlags = bindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &flagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+	VULKAN_CALL_ERROR(vkCreateDescriptorSetLayout(GPU, &layoutInfo, nullptr, &setLayout), "failed to create bindless descriptor set layout");
+
+	std::array<VkDescriptorPoolSize, 3> poolSizes{};
+	poolSizes[0] = { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, images.capacity };
+	poolSizes[1] = { VK_DESCRIPTOR_TYPE_SAMPLER, samplers.capacity };
+	poolSizes[2] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageBuffers.capacity };
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	VULKAN_CALL_ERROR(vkCreateDescriptorPool(GPU, &poolInfo, nullptr, &pool), "failed to create bindless descriptor pool");
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &setLayout;
+	VULKAN_CALL_ERROR(vkAllocateDescriptorSets(GPU, &allocInfo, &set), "failed to allocate bindless descriptor set");
+
+	std::cout << "bindless table: " << images.capacity << " images, " << samplers.capacity << " samplers, "
+		<< storageBuffers.capacity << " storage buffers" << std::endl;
+}
+
+void BindlessResourceTable::Destroy()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	if (pool != VK_NULL_HANDLE) vkDestroyDescriptorPool(GPU, pool, nullptr);
+	if (setLayout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(GPU, setLayout, nullptr);
+
+	pool = VK_NULL_HANDLE;
+	setLayout = VK_NULL_HANDLE;
+	set = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessResourceTable::RegisterImage(VkImageView view, VkImageLayout layout)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	uint32_t index = images.Acquire();
+	writeImage(index, view, layout);
+	return index;
+}
+
+uint32_t BindlessResourceTable::RegisterSampler(VkSampler sampler)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	uint32_t index = samplers.Acquire();
+
+	VkDescriptorImageInfo samplerInfo{};
+	samplerInfo.sampler = sampler;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = BINDLESS_SAMPLER_BINDING;
+	write.dstArrayElement = index;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+	write.descriptorCount = 1;
+	write.pImageInfo = &samplerInfo;
+	vkUpdateDescriptorSets(GPU, 1, &write, 0, nullptr);
+
+	return index;
+}
+
+uint32_t BindlessResourceTable::RegisterStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	uint32_t index = storageBuffers.Acquire();
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = BINDLESS_STORAGE_BUFFER_BINDING;
+	write.dstArrayElement = index;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.descriptorCount = 1;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(GPU, 1, &write, 0, nullptr);
+
+	return index;
+}
+
+void BindlessResourceTable::UpdateImage(uint32_t index, VkImageView view, VkImageLayout layout)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	assert(index < images.next);
+	writeImage(index, view, layout);
+}
+
+void BindlessResourceTable::ReleaseImage(uint32_t index)
+{
+	release(&images, index);
+}
+
+void BindlessResourceTable::ReleaseSampler(uint32_t index)
+{
+	release(&samplers, index);
+}
+
+void BindlessResourceTable::ReleaseStorageBuffer(uint32_t index)
+{
+	release(&storageBuffers, index);
+}
+
+void BindlessResourceTable::Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout)
+{
+	vkCmdBindDescriptorSets(cmd, bindPoint, layout, 0, 1, &set, 0, nullptr);
+}
+
+VkDescriptorSetLayout BindlessResourceTable::GetDescriptorSetLayout() const
+{
+	return setLayout;
+}
+
+VkDescriptorSet BindlessResourceTable::GetDescriptorSet() const
+{
+	return set;
+}
+
+BindlessTableStats BindlessResourceTable::GetStats()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	BindlessTableStats stats{};
+	stats.images = images.used;
+	stats.samplers = samplers.used;
+	stats.storageBuffers = storageBuffers.used;
+	stats.imageCapacity = images.capacity;
+	stats.samplerCapacity = samplers.capacity;
+	stats.storageBufferCapacity = storageBuffers.capacity;
+	return stats;
+}
+
+void BindlessResourceTable::release(SlotArray* pSlots, uint32_t index)
+{
+	if (index == BINDLESS_INVALID_INDEX)
+		return;
+
+	//the descriptor stays as is, partially bound only cares about slots shaders actually read
+	pDevice->GetDeletionQueue()->Enqueue([this, pSlots, index]()
+	{
+		std::lock_guard<std::mutex> _lock(lock);
+
+		pSlots->freeSlots.push_back(index);
+		pSlots->used--;
+	});
+}
+
+void BindlessResourceTable::writeImage(uint32_t index, VkImageView view, VkImageLayout layout)
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageView = view;
+	imageInfo.imageLayout = layout;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = set;
+	write.dstBinding = BINDLESS_IMAGE_BINDING;
+	write.dstArrayElement = index;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+	write.descriptorCount = 1;
+	write.pImageInfo = &imageInfo;
+	vkUpdateDescriptorSets(GPU, 1, &write, 0, nullptr);
+}
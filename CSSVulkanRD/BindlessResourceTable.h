@@ -0,0 +1,82 @@
+#pragma once
+#include "includes.h"
+
+class GraphicsDevice;
+
+//binding slots of the bindless set, must match shaders/bindless.glsl
+const uint32_t BINDLESS_IMAGE_BINDING = 0;
+const uint32_t BINDLESS_SAMPLER_BINDING = 1;
+const uint32_t BINDLESS_STORAGE_BUFFER_BINDING = 2;
+
+const uint32_t BINDLESS_MAX_IMAGES = 16384; //upper bounds, clamped to the device's update after bind limits
+const uint32_t BINDLESS_MAX_SAMPLERS = 256;
+const uint32_t BINDLESS_MAX_STORAGE_BUFFERS = 8192;
+const uint32_t BINDLESS_RESERVED_RESOURCES = 64; //per stage headroom left for the per pipeline set next to the table
+
+const uint32_t BINDLESS_INVALID_INDEX = 0xFFFFFFFF;
+
+struct BindlessTableStats
+{
+	uint32_t images;
+	uint32_t samplers;
+	uint32_t storageBuffers;
+	uint32_t imageCapacity;
+	uint32_t samplerCapacity;
+	uint32_t storageBufferCapacity;
+};
+
+//one big descriptor set of partially bound, update after bind arrays. resources are registered once and keep their
+//index until released, shaders pick them by index (push constant or instance data) so a whole frame binds a single set.
+//pipelines opt in with PipelineState::SetBindlessTable, the table then occupies set 0
+class BindlessResourceTable
+{
+public:
+	BindlessResourceTable(GraphicsDevice* pDevice, uint32_t maxImages, uint32_t maxSamplers, uint32_t maxStorageBuffers);
+	~BindlessResourceTable();
+
+	void Create();
+	void Destroy();
+
+	uint32_t RegisterImage(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	uint32_t RegisterSampler(VkSampler sampler);
+	uint32_t RegisterStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+	//same index, new view. only legal while no frame in flight reads the slot, otherwise register a new one and release this
+	void UpdateImage(uint32_t index, VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	//the slot is handed out again once frames in flight that may still read it have retired
+	void ReleaseImage(uint32_t index);
+	void ReleaseSampler(uint32_t index);
+	void ReleaseStorageBuffer(uint32_t index);
+
+	void Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout);
+
+	VkDescriptorSetLayout GetDescriptorSetLayout() const;
+	VkDescriptorSet GetDescriptorSet() const;
+	BindlessTableStats GetStats();
+private:
+	struct SlotArray
+	{
+		uint32_t capacity;
+		uint32_t next; //high water mark
+		std::vector<uint32_t> freeSlots;
+		uint32_t used;
+
+		uint32_t Acquire();
+	};
+
+	void release(SlotArray* pSlots, uint32_t index);
+	void writeImage(uint32_t index, VkImageView view, VkImageLayout layout);
+
+	SlotArray images;
+	SlotArray samplers;
+	SlotArray storageBuffers;
+
+	VkDescriptorSetLayout setLayout;
+	VkDescriptorPool pool;
+	VkDescriptorSet set;
+
+	std::mutex lock;
+	GraphicsDevice* pDevice;
+	VkDevice GPU;
+};
@@ -4,23 +4,112 @@
 #include "GPUBuffer.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include "DeviceContext.h"
+#include "JobSystem.h"
+#include "PresentationController.h"
+#include "PipelineStateCache.h"
+#include "DescriptorLayoutCache.h"
+#include "PipelineManifest.h"
+#include "BatchRenderer.h"
+#include <chrono>
 
 void CatastrophicVulkanFrameworkApplication::Run()
 {
+	Headless = false;
+	pJobs = new JobSystem();
+
 	InitializeApplicationWindow(800, 600);
 	InitializeGraphicsSubsystem();
 	InitializeFramebufferResizeHooks();
 
+	pGraphics->GetPipelineManifest()->WarmUp(pJobs); //loading screen
+
 	MainLoop();
 
 	Shutdown();
 }
 
+void CatastrophicVulkanFrameworkApplication::RunHeadless(uint32 width, uint32 height, uint32 frameCount)
+{
+	Headless = true;
+	ApplicationWindow = nullptr;
+	WindowWidth = width;
+	WindowHeight = height;
+
+	pJobs = new JobSystem();
+
+	pGraphics = new GraphicsDevice(VkExtent2D{ width, height });
+	pGraphics->InitializeVulkan();
+	pGraphics->GetPipelineManifest()->WarmUp(pJobs);
+
+	Initialize();
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (uint32 i = 0; i < frameCount; ++i)
+	{
+		Update();
+		Render();
+	}
+
+	pGraphics->WaitForGPUIdle();
+
+	double totalMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	pGraphics->GetPresentationController()->PrintStats();
+	std::cout << "headless: " << frameCount << " frames in " << totalMs << " ms (" << (frameCount ? totalMs / frameCount : 0.0) << " ms/frame)" << std::endl;
+
+	DestroyResources();
+
+	Shutdown();
+}
+
+void CatastrophicVulkanFrameworkApplication::RunBatch(uint32 width, uint32 height, uint32 jobCount, uint32 concurrentJobs)
+{
+	Headless = true;
+	ApplicationWindow = nullptr;
+	WindowWidth = width;
+	WindowHeight = height;
+
+	pJobs = new JobSystem();
+
+	pGraphics = new GraphicsDevice(VkExtent2D{ width, height });
+	pGraphics->InitializeVulkan();
+	pGraphics->GetPipelineManifest()->WarmUp(pJobs);
+
+	Initialize(); //pipelines target the headless render pass, which the batch render pass is compatible with
+
+	BatchRenderer batch(pGraphics, pJobs, concurrentJobs);
+	for (uint32 i = 0; i < jobCount; ++i)
+	{
+		RenderJob job{};
+		job.width = width;
+		job.height = height;
+		job.record = [this](VkCommandBuffer cmd, VkExtent2D extent) { RecordBatchJob(cmd, extent); };
+		job.encoding = ImageEncoding::PPM; //no output path, encoded and dropped
+		batch.Submit(std::move(job));
+	}
+
+	batch.Run(); //prints jobs/s
+
+	pGraphics->WaitForGPUIdle();
+	batch.Destroy();
+
+	DestroyResources();
+
+	Shutdown();
+}
+
 void CatastrophicVulkanFrameworkApplication::Shutdown()
 {
+	pJobs->Shutdown();
+	delete pJobs;
+
 	pGraphics->ShutdownVulkan();
-	glfwDestroyWindow(ApplicationWindow);
-	glfwTerminate();
+
+	if (!Headless)
+	{
+		glfwDestroyWindow(ApplicationWindow);
+		glfwTerminate();
+	}
 }
 
 struct WorldViewProjection
@@ -75,9 +164,13 @@ void CatastrophicVulkanFrameworkApplication::MainLoop()
 
 	Initialize();
 
+	auto presentation = pGraphics->GetPresentationController();
+
 	while (!glfwWindowShouldClose(ApplicationWindow))
 	{
+		presentation->WaitForNextFrame(); //frame pacing, no-op without a target frame rate
 		glfwPollEvents();
+		presentation->MarkInput();
 
 		Update();
 		Render();
@@ -101,6 +194,10 @@ void CatastrophicVulkanFrameworkApplication::MainLoop()
 		//Sleep(13);
 	}
 
+	presentation->PrintStats();
+	pGraphics->GetPipelineStateCache()->PrintStats();
+	pGraphics->GetDescriptorLayoutCache()->PrintStats();
+
 	DestroyResources();
 
 	pGraphics->WaitForGPUIdle();
@@ -2,24 +2,30 @@
 #include "includes.h"
 
 class GraphicsDevice;
+class JobSystem;
 
 class CatastrophicVulkanFrameworkApplication
 {
 public:
 	void Run();
+	void RunHeadless(uint32 width, uint32 height, uint32 frameCount); //offscreen, no window or presentation, prints frame timing
+	void RunBatch(uint32 width, uint32 height, uint32 jobCount, uint32 concurrentJobs = 4); //offscreen through BatchRenderer, prints jobs/s
 protected:
 	virtual void Initialize() = 0;
 	virtual void Update() = 0;
 	virtual void Render() = 0;
 	virtual void DestroyResources() = 0;
+	virtual void RecordBatchJob(VkCommandBuffer cmd, VkExtent2D extent) {} //draws of one RunBatch job, inside its render pass
 
 	GraphicsDevice* pGraphics;
+	JobSystem* pJobs; //shared task scheduler for update, asset loading and command recording
 private:
 	GLFWwindow* ApplicationWindow;
 
 	uint32 WindowWidth;
 	uint32 WindowHeight;
 	bool Fullscreen;
+	bool Headless;
 
 	void MainLoop();
 	void Shutdown();
@@ -0,0 +1,194 @@
+#include "ComputePipelineState.h"
+#include "Shader.h"
+#include "GraphicsDevice.h"
+#include "PipelineCache.h"
+#include "DescriptorLayoutCache.h"
+#include "DescriptorAllocator.h"
+#include "DescriptorSetWriter.h"
+#include "DeferredDeletionQueue.h"
+
+ComputePipelineState::ComputePipelineState(GraphicsDevice* pDevice, uint32_t numDescriptorSets)
+{
+	this->pDevice = pDevice;
+	GPU = pDevice->GetGPU();
+
+	pipeline = VK_NULL_HANDLE;
+	pipelineLayout = VK_NULL_HANDLE;
+	descriptorSetLayout = VK_NULL_HANDLE;
+	pDescriptorAllocator = pDevice->GetDescriptorAllocator().get();
+	pDescriptorWriter = nullptr;
+	pShader = nullptr;
+	shaderStage = {};
+
+	this->numDescriptorSets = numDescriptorSets;
+	descriptorSets.resize(numDescriptorSets, VK_NULL_HANDLE);
+
+	dirty = false;
+}
+
+ComputePipelineState::~ComputePipelineState()
+{
+}
+
+void ComputePipelineState::SetShader(Shader* pShader)
+{
+	if (!pShader->StageExists(VK_SHADER_STAGE_COMPUTE_BIT))
+		throw std::runtime_error("compute pipeline requires a compute shader stage");
+
+	this->pShader = pShader;
+
+	auto cs = pShader->GetShader(VK_SHADER_STAGE_COMPUTE_BIT);
+	shaderStage = {};
+	shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStage.module = cs->module;
+	shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	shaderStage.pName = cs->entrypoint;
+
+	dirty = true;
+}
+
+void ComputePipelineState::AddPushConstantRange(VkPushConstantRange range)
+{
+	pushConstantRanges.push_back(range);
+	dirty = true;
+}
+
+VkDescriptorSet ComputePipelineState::GetDescriptorSet(uint32_t index)
+{
+	assert(index < descriptorSets.size());
+
+	if (pDescriptorWriter && descriptorSets[index] != VK_NULL_HANDLE)
+		pDescriptorWriter->Flush(descriptorSets[index]);
+
+	return descriptorSets[index];
+}
+
+void ComputePipelineState::RegisterDescriptorSetLayoutBinding(VkDescriptorSetLayoutBinding binding)
+{
+	descriptorSetLayoutBindings.push_back(binding);
+	dirty = true;
+}
+
+void ComputePipelineState::SetDescriptorAllocator(DescriptorAllocator* pAllocator)
+{
+	pDescriptorAllocator = pAllocator;
+}
+
+void ComputePipelineState::UpdateBufferDescriptor(uint32_t descriptorSetIndex, uint32_t descriptorBindingIndex, VkDescriptorType type, VkBuffer gpuBuffer, VkDeviceSize bindOffset, VkDeviceSize bindSize)
+{
+	assert(descriptorSetIndex < descriptorSets.size());
+
+	getWriter(descriptorBindingIndex, type)->SetBuffer(descriptorSets[descriptorSetIndex], descriptorBindingIndex, gpuBuffer, bindOffset, bindSize);
+}
+
+void ComputePipelineState::UpdateImageDescriptor(uint32_t descriptorSetIndex, uint32_t descriptorBindingIndex, VkDescriptorType type, VkImageView view, VkImageLayout layout, VkSampler sampler)
+{
+	assert(descriptorSetIndex < descriptorSets.size());
+
+	getWriter(descriptorBindingIndex, type)->SetImage(descriptorSets[descriptorSetIndex], descriptorBindingIndex, view, layout, sampler);
+}
+
+void ComputePipelineState::Build()
+{
+	if (dirty)
+	{
+		if (!pShader)
+			throw std::runtime_error("compute pipeline built without a shader");
+
+		Destroy(); //rebuilding, the previous pipeline is retired once the compute work using it completes
+
+		createDescriptorSetLayout();
+		createDescriptorSets();
+
+		pipelineLayout = pDevice->GetDescriptorLayoutCache()->AcquirePipelineLayout({ descriptorSetLayout }, pushConstantRanges); //currently 1 descriptor set supported
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage = shaderStage;
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		VULKAN_CALL_ERROR(vkCreateComputePipelines(GPU, pDevice->GetPipelineCache()->GetCache(), 1, &pipelineInfo, nullptr, &pipeline), "failed to create compute pipeline");
+		dirty = false;
+	}
+}
+
+void ComputePipelineState::Destroy()
+{
+	if (pDescriptorWriter)
+	{
+		pDescriptorWriter->Destroy(); //no update after this, the template can go right away
+		delete pDescriptorWriter;
+		pDescriptorWriter = nullptr;
+	}
+
+	if (pipeline == VK_NULL_HANDLE && pipelineLayout == VK_NULL_HANDLE && descriptorSetLayout == VK_NULL_HANDLE)
+		return;
+
+	//dispatches recorded with these may still be in flight on the compute queue
+	VkDevice gpu = GPU;
+	DescriptorAllocator* pAllocator = pDescriptorAllocator;
+	auto layoutCache = pDevice->GetDescriptorLayoutCache();
+	VkPipeline oldPipeline = pipeline;
+	VkPipelineLayout oldLayout = pipelineLayout;
+	VkDescriptorSetLayout oldSetLayout = descriptorSetLayout;
+	std::vector<VkDescriptorSet> oldSets;
+	for (VkDescriptorSet& set : descriptorSets)
+	{
+		if (set != VK_NULL_HANDLE) oldSets.push_back(set);
+		set = VK_NULL_HANDLE;
+	}
+	pDevice->GetDeletionQueue(VK_QUEUE_COMPUTE_BIT)->Enqueue([gpu, pAllocator, layoutCache, oldPipeline, oldLayout, oldSetLayout, oldSets]()
+	{
+		if (oldPipeline != VK_NULL_HANDLE) vkDestroyPipeline(gpu, oldPipeline, nullptr);
+		if (pAllocator)
+		{
+			for (VkDescriptorSet set : oldSets)
+				pAllocator->Free(set);
+		}
+		if (oldLayout != VK_NULL_HANDLE) layoutCache->ReleasePipelineLayout(oldLayout);
+		if (oldSetLayout != VK_NULL_HANDLE) layoutCache->ReleaseDescriptorSetLayout(oldSetLayout);
+	});
+
+	pipeline = VK_NULL_HANDLE;
+	pipelineLayout = VK_NULL_HANDLE;
+	descriptorSetLayout = VK_NULL_HANDLE;
+}
+
+VkPipeline ComputePipelineState::GetPipeline() const
+{
+	return pipeline;
+}
+
+VkPipelineLayout ComputePipelineState::GetPipelineLayout() const
+{
+	return pipelineLayout;
+}
+
+void ComputePipelineState::createDescriptorSetLayout()
+{
+	descriptorSetLayout = pDevice->GetDescriptorLayoutCache()->AcquireDescriptorSetLayout(descriptorSetLayoutBindings);
+}
+
+void ComputePipelineState::createDescriptorSets()
+{
+	if (descriptorSetLayoutBindings.empty())
+		return; //layout with no bindings, nothing to allocate
+
+	pDescriptorAllocator->Allocate(descriptorSetLayout, numDescriptorSets, descriptorSets.data());
+	pDescriptorWriter = new DescriptorSetWriter(GPU, descriptorSetLayout, DescriptorLayoutCache::NormalizeBindings(descriptorSetLayoutBindings));
+}
+
+DescriptorSetWriter* ComputePipelineState::getWriter(uint32_t binding, VkDescriptorType type)
+{
+	if (!pDescriptorWriter)
+		throw std::runtime_error("compute descriptor set not allocated, call Build first");
+
+	for (const auto& layoutBinding : descriptorSetLayoutBindings)
+	{
+		if (layoutBinding.binding == binding && layoutBinding.descriptorType != type)
+			throw std::runtime_error("compute descriptor type doesn't match binding " + std::to_string(binding));
+	}
+
+	return pDescriptorWriter;
+}
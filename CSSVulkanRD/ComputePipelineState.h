@@ -0,0 +1,53 @@
+#pragma once
+#include "includes.h"
+
+class Shader;
+class GraphicsDevice;
+class DescriptorAllocator;
+class DescriptorSetWriter;
+
+//compute counterpart of PipelineState, one shader stage and a layout, no fixed function state
+class ComputePipelineState
+{
+public:
+	ComputePipelineState(GraphicsDevice* pDevice, uint32_t numDescriptorSets);
+	~ComputePipelineState();
+
+	void SetShader(Shader* pShader);
+	void AddPushConstantRange(VkPushConstantRange range);
+
+	VkDescriptorSet GetDescriptorSet(uint32_t index); //applies pending descriptor writes first
+	void RegisterDescriptorSetLayoutBinding(VkDescriptorSetLayoutBinding binding);
+	void SetDescriptorAllocator(DescriptorAllocator* pAllocator); //defaults to the device's persistent allocator
+	void UpdateBufferDescriptor(uint32_t descriptorSetIndex, uint32_t descriptorBindingIndex, VkDescriptorType type, VkBuffer gpuBuffer, VkDeviceSize bindOffset, VkDeviceSize bindSize);
+	void UpdateImageDescriptor(uint32_t descriptorSetIndex, uint32_t descriptorBindingIndex, VkDescriptorType type, VkImageView view, VkImageLayout layout, VkSampler sampler = VK_NULL_HANDLE);
+
+	void Build();
+	void Destroy();
+
+	VkPipeline GetPipeline() const;
+	VkPipelineLayout GetPipelineLayout() const;
+private:
+	VkPipeline pipeline;
+	VkPipelineLayout pipelineLayout;
+	VkDescriptorSetLayout descriptorSetLayout;
+	DescriptorAllocator* pDescriptorAllocator;
+	DescriptorSetWriter* pDescriptorWriter; //writes are cached and applied when the set is fetched for binding
+
+	Shader* pShader;
+	VkPipelineShaderStageCreateInfo shaderStage;
+
+	std::vector<VkPushConstantRange> pushConstantRanges;
+	std::vector<VkDescriptorSet> descriptorSets; //one per frame in flight
+	std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings;
+
+	void createDescriptorSetLayout();
+	void createDescriptorSets();
+	DescriptorSetWriter* getWriter(uint32_t binding, VkDescriptorType type);
+
+	GraphicsDevice* pDevice;
+	VkDevice GPU;
+
+	bool dirty;
+	uint32_t numDescriptorSets;
+};
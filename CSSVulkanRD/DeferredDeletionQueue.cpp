@@ -0,0 +1,86 @@
+#include "DeferredDeletionQueue.h"
+#include "GPUQueue.h"
+
+DeferredDeletionQueue::DeferredDeletionQueue(GPUQueue* pQueue)
+{
+	this->pQueue = pQueue;
+}
+
+DeferredDeletionQueue::~DeferredDeletionQueue()
+{
+}
+
+void DeferredDeletionQueue::Enqueue(std::function<void()> deleter)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	unsealed.push_back(std::move(deleter));
+}
+
+void DeferredDeletionQueue::Enqueue(uint64_t timelineValue, std::function<void()> deleter)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	//almost always appends, explicit older values get sorted in so Collect can stop at the first pending one
+	auto it = pending.end();
+	while (it != pending.begin() && (it - 1)->timelineValue > timelineValue)
+		--it;
+
+	pending.insert(it, { timelineValue, std::move(deleter) });
+}
+
+void DeferredDeletionQueue::Seal()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	if (unsealed.empty())
+		return;
+
+	//the newest value, so these always append
+	uint64_t timelineValue = pQueue->GetLastSubmittedValue();
+	for (auto& deleter : unsealed)
+		pending.push_back({ std::max(timelineValue, pending.empty() ? 0 : pending.back().timelineValue), std::move(deleter) });
+	unsealed.clear();
+}
+
+void DeferredDeletionQueue::Collect()
+{
+	std::vector<std::function<void()>> ready;
+	{
+		std::lock_guard<std::mutex> _lock(lock);
+
+		if (pending.empty())
+			return;
+
+		uint64_t completed = pQueue->GetCompletedValue();
+		while (!pending.empty() && pending.front().timelineValue <= completed)
+		{
+			ready.push_back(std::move(pending.front().deleter));
+			pending.pop_front();
+		}
+	}
+
+	for (auto& deleter : ready) //outside the lock, deleters may enqueue more work
+		deleter();
+}
+
+void DeferredDeletionQueue::Flush()
+{
+	Seal(); //shutdown, nothing is recording anymore
+
+	uint64_t last = 0;
+	{
+		std::lock_guard<std::mutex> _lock(lock);
+		if (!pending.empty())
+			last = std::min(pending.back().timelineValue, pQueue->GetLastSubmittedValue()); //never wait on a value nobody will signal
+	}
+
+	pQueue->Wait(last);
+	Collect();
+}
+
+uint32_t DeferredDeletionQueue::GetPendingCount()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+	return (uint32_t)(pending.size() + unsealed.size());
+}
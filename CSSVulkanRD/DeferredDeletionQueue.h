@@ -0,0 +1,37 @@
+#pragma once
+#include "includes.h"
+#include <functional>
+#include <deque>
+
+class GPUQueue;
+
+//destroys gpu objects once the queue timeline passes the point of their last use, instead of idling the device
+class DeferredDeletionQueue
+{
+public:
+	DeferredDeletionQueue(GPUQueue* pQueue);
+	~DeferredDeletionQueue();
+
+	//the object may still be referenced by command buffers that are being recorded and not submitted yet, so its
+	//timeline point isn't known here. it is assigned by the next Seal, at the frame boundary once they are submitted
+	void Enqueue(std::function<void()> deleter);
+	void Enqueue(uint64_t timelineValue, std::function<void()> deleter);
+
+	void Seal(); //retires everything enqueued without a value at the queue's current last submission
+	void Collect(); //runs every deleter whose timeline point has completed, never blocks
+	void Flush(); //waits for the queue and runs everything, for shutdown
+
+	uint32_t GetPendingCount();
+private:
+	struct PendingDeletion
+	{
+		uint64_t timelineValue;
+		std::function<void()> deleter;
+	};
+
+	std::deque<PendingDeletion> pending; //sorted by timelineValue
+	std::vector<std::function<void()>> unsealed;
+	std::mutex lock;
+
+	GPUQueue* pQueue;
+};
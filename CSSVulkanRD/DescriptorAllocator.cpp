@@ -0,0 +1,173 @@
+#include "DescriptorAllocator.h"
+
+const uint32_t MAX_SETS_PER_POOL = 4096;
+
+DescriptorAllocator::DescriptorAllocator(VkDevice GPU, uint32_t setsPerPool, const std::vector<DescriptorPoolRatio>& ratios, VkDescriptorPoolCreateFlags flags)
+{
+	this->GPU = GPU;
+	this->setsPerPool = std::max(setsPerPool, 1u);
+	this->ratios = ratios;
+	this->flags = flags;
+
+	currentPool = VK_NULL_HANDLE;
+	allocations = 0;
+	poolGrowths = 0;
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	Allocate(layout, 1, &set);
+	return set;
+}
+
+void DescriptorAllocator::Allocate(VkDescriptorSetLayout layout, uint32_t count, VkDescriptorSet* pSets)
+{
+	if (count == 0)
+		return;
+
+	std::vector<VkDescriptorSetLayout> layouts(count, layout);
+
+	std::lock_guard<std::mutex> _lock(lock);
+
+	if (currentPool == VK_NULL_HANDLE)
+		currentPool = nextPool();
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = currentPool;
+	allocInfo.descriptorSetCount = count;
+	allocInfo.pSetLayouts = layouts.data();
+
+	VkResult result = vkAllocateDescriptorSets(GPU, &allocInfo, pSets);
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		//retry once in a fresh pool, a second failure means the layout doesn't fit any pool we make
+		currentPool = nextPool();
+		allocInfo.descriptorPool = currentPool;
+		result = vkAllocateDescriptorSets(GPU, &allocInfo, pSets);
+	}
+	VULKAN_CALL_ERROR(result, "failed to allocate descriptor sets");
+
+	if (flags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+	{
+		for (uint32_t i = 0; i < count; ++i)
+			setOwners[pSets[i]] = currentPool;
+	}
+
+	allocations += count;
+}
+
+void DescriptorAllocator::Free(VkDescriptorSet set)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	auto owner = setOwners.find(set);
+	if (owner == setOwners.end())
+		return;
+
+	VULKAN_CALL(vkFreeDescriptorSets(GPU, owner->second, 1, &set));
+	setOwners.erase(owner);
+}
+
+void DescriptorAllocator::Reset()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	for (VkDescriptorPool pool : usedPools)
+	{
+		VULKAN_CALL(vkResetDescriptorPool(GPU, pool, 0));
+		freePools.push_back(pool);
+	}
+	usedPools.clear();
+	setOwners.clear();
+	currentPool = VK_NULL_HANDLE;
+}
+
+DescriptorAllocatorStats DescriptorAllocator::GetStats()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	DescriptorAllocatorStats stats{};
+	stats.pools = static_cast<uint32_t>(usedPools.size() + freePools.size());
+	stats.setsPerPool = setsPerPool;
+	stats.allocations = allocations;
+	stats.poolGrowths = poolGrowths;
+	return stats;
+}
+
+void DescriptorAllocator::Destroy()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	for (VkDescriptorPool pool : usedPools)
+		vkDestroyDescriptorPool(GPU, pool, nullptr);
+	for (VkDescriptorPool pool : freePools)
+		vkDestroyDescriptorPool(GPU, pool, nullptr);
+
+	usedPools.clear();
+	freePools.clear();
+	setOwners.clear();
+	currentPool = VK_NULL_HANDLE;
+}
+
+std::vector<DescriptorPoolRatio> DescriptorAllocator::DefaultRatios()
+{
+	return {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f }
+	};
+}
+
+VkDescriptorPool DescriptorAllocator::createPool()
+{
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (const auto& ratio : ratios)
+	{
+		uint32_t count = static_cast<uint32_t>(ratio.descriptorsPerSet * setsPerPool);
+		poolSizes.push_back({ ratio.type, std::max(count, 1u) });
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = flags;
+	poolInfo.maxSets = setsPerPool;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool;
+	VULKAN_CALL_ERROR(vkCreateDescriptorPool(GPU, &poolInfo, nullptr, &pool), "failed to create descriptor pool");
+	return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::nextPool()
+{
+	VkDescriptorPool pool;
+	if (!freePools.empty())
+	{
+		pool = freePools.back();
+		freePools.pop_back();
+	}
+	else
+	{
+		if (!usedPools.empty())
+		{
+			//ran out, the next pool is bigger so a busy arena settles on a few large pools
+			setsPerPool = std::min(setsPerPool + setsPerPool / 2, MAX_SETS_PER_POOL);
+			poolGrowths++;
+		}
+		pool = createPool();
+	}
+
+	usedPools.push_back(pool);
+	return pool;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "includes.h"
+#include <unordered_map>
+
+struct DescriptorPoolRatio
+{
+	VkDescriptorType type;
+	float descriptorsPerSet; //pool size = descriptorsPerSet * maxSets
+};
+
+struct DescriptorAllocatorStats
+{
+	uint32_t pools;
+	uint32_t setsPerPool; //size of the next pool created
+	uint64_t allocations;
+	uint64_t poolGrowths; //pools created after the first because the current one ran out
+};
+
+//hands out descriptor sets from a chain of pools. when the current pool runs out another one is taken from the free
+//list or created, each new pool bigger than the last, so allocation never fails for lack of pool space.
+//transient allocators (frame arenas) are Reset as a whole once the gpu is done with them, persistent ones are created
+//with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT and Free individual sets
+class DescriptorAllocator
+{
+public:
+	DescriptorAllocator(VkDevice GPU, uint32_t setsPerPool, const std::vector<DescriptorPoolRatio>& ratios, VkDescriptorPoolCreateFlags flags = 0);
+	~DescriptorAllocator();
+
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout); //thread safe
+	void Allocate(VkDescriptorSetLayout layout, uint32_t count, VkDescriptorSet* pSets);
+	void Free(VkDescriptorSet set); //no-op on transient allocators, their sets go away with Reset
+	void Reset(); //every set handed out becomes invalid, the pools are kept for reuse
+
+	DescriptorAllocatorStats GetStats();
+
+	void Destroy();
+
+	static std::vector<DescriptorPoolRatio> DefaultRatios();
+private:
+	VkDescriptorPool createPool();
+	VkDescriptorPool nextPool(); //current pool is full
+
+	std::vector<VkDescriptorPool> usedPools;
+	std::vector<VkDescriptorPool> freePools; //reset, ready for reuse
+	VkDescriptorPool currentPool;
+	std::unordered_map<VkDescriptorSet, VkDescriptorPool> setOwners; //persistent allocators only, vkFreeDescriptorSets needs the pool
+
+	std::vector<DescriptorPoolRatio> ratios;
+	VkDescriptorPoolCreateFlags flags;
+	uint32_t setsPerPool;
+
+	uint64_t allocations;
+	uint64_t poolGrowths;
+
+	std::mutex lock;
+	VkDevice GPU;
+};
@@ -0,0 +1,195 @@
+#include "DescriptorLayoutCache.h"
+#include <map>
+
+DescriptorLayoutCache::DescriptorLayoutCache(VkDevice GPU)
+{
+	this->GPU = GPU;
+	hits = 0;
+	misses = 0;
+}
+
+DescriptorLayoutCache::~DescriptorLayoutCache()
+{
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::AcquireDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags)
+{
+	std::vector<VkDescriptorSetLayoutBinding> normalized = NormalizeBindings(bindings);
+
+	PipelineKey key;
+	key.Add(flags);
+	for (const auto& binding : normalized)
+	{
+		key.Add(binding.binding);
+		key.Add(binding.descriptorType);
+		key.Add(binding.descriptorCount);
+		key.Add(binding.stageFlags);
+		key.Add(binding.pImmutableSamplers != nullptr);
+		if (binding.pImmutableSamplers) //by value, samplers come from SamplerCache so equal handles mean equal samplers
+			for (uint32_t i = 0; i < binding.descriptorCount; ++i)
+				key.Add(binding.pImmutableSamplers[i]);
+	}
+	size_t hash = key.Hash();
+
+	std::lock_guard<std::mutex> _lock(lock);
+
+	VkDescriptorSetLayout setLayout = setLayouts.Find(key, hash);
+	if (setLayout != VK_NULL_HANDLE)
+	{
+		hits++;
+		return setLayout;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.flags = flags;
+	layoutInfo.bindingCount = static_cast<uint32_t>(normalized.size());
+	layoutInfo.pBindings = normalized.empty() ? nullptr : normalized.data();
+	VULKAN_CALL_ERROR(vkCreateDescriptorSetLayout(GPU, &layoutInfo, nullptr, &setLayout), "failed to create descriptor set layout");
+
+	setLayouts.Insert(key, hash, setLayout);
+	misses++;
+	return setLayout;
+}
+
+VkPipelineLayout DescriptorLayoutCache::AcquirePipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayoutHandles, const std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+	std::vector<VkPushConstantRange> normalized = NormalizePushConstantRanges(pushConstantRanges);
+
+	//set order is the set index, so it stays as given. set layouts are cached, equal handles mean equal layouts
+	PipelineKey key;
+	key.Add(setLayoutHandles.size());
+	for (VkDescriptorSetLayout setLayout : setLayoutHandles)
+		key.Add(setLayout);
+	for (const auto& range : normalized)
+		key.Add(range);
+	size_t hash = key.Hash();
+
+	std::lock_guard<std::mutex> _lock(lock);
+
+	VkPipelineLayout layout = pipelineLayouts.Find(key, hash);
+	if (layout != VK_NULL_HANDLE)
+	{
+		hits++;
+		return layout;
+	}
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = static_cast<uint32_t>(setLayoutHandles.size());
+	layoutInfo.pSetLayouts = setLayoutHandles.empty() ? nullptr : setLayoutHandles.data();
+	layoutInfo.pushConstantRangeCount = static_cast<uint32_t>(normalized.size());
+	layoutInfo.pPushConstantRanges = normalized.empty() ? nullptr : normalized.data();
+	VULKAN_CALL_ERROR(vkCreatePipelineLayout(GPU, &layoutInfo, nullptr, &layout), "failed to create pipeline layout");
+
+	pipelineLayouts.Insert(key, hash, layout);
+	misses++;
+	return layout;
+}
+
+void DescriptorLayoutCache::ReleaseDescriptorSetLayout(VkDescriptorSetLayout setLayout)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	if (setLayouts.Release(setLayout))
+		vkDestroyDescriptorSetLayout(GPU, setLayout, nullptr);
+}
+
+void DescriptorLayoutCache::ReleasePipelineLayout(VkPipelineLayout layout)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	if (pipelineLayouts.Release(layout))
+		vkDestroyPipelineLayout(GPU, layout, nullptr);
+}
+
+DescriptorLayoutCacheStats DescriptorLayoutCache::GetStats()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	DescriptorLayoutCacheStats stats{};
+	stats.descriptorSetLayouts = setLayouts.Size();
+	stats.pipelineLayouts = pipelineLayouts.Size();
+	stats.hits = hits;
+	stats.misses = misses;
+	return stats;
+}
+
+void DescriptorLayoutCache::PrintStats()
+{
+	DescriptorLayoutCacheStats stats = GetStats();
+	std::cout << "layouts: " << stats.descriptorSetLayouts << " set layouts, " << stats.pipelineLayouts << " pipeline layouts, "
+		<< stats.hits << " hits, " << stats.misses << " misses" << std::endl;
+}
+
+void DescriptorLayoutCache::Destroy()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	for (VkPipelineLayout layout : pipelineLayouts.Clear())
+		vkDestroyPipelineLayout(GPU, layout, nullptr);
+	for (VkDescriptorSetLayout setLayout : setLayouts.Clear())
+		vkDestroyDescriptorSetLayout(GPU, setLayout, nullptr);
+}
+
+std::vector<VkDescriptorSetLayoutBinding> DescriptorLayoutCache::NormalizeBindings(std::vector<VkDescriptorSetLayoutBinding> bindings)
+{
+	std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+	{
+		return a.binding < b.binding;
+	});
+
+	for (size_t i = 1; i < bindings.size(); ++i)
+	{
+		if (bindings[i].binding == bindings[i - 1].binding)
+			throw std::runtime_error("descriptor set layout declares binding " + std::to_string(bindings[i].binding) + " twice");
+	}
+
+	return bindings;
+}
+
+std::vector<VkPushConstantRange> DescriptorLayoutCache::NormalizePushConstantRanges(const std::vector<VkPushConstantRange>& declared)
+{
+	//a stage may only appear in one range of a layout, so each stage gets the union of everything declared for it
+	std::map<uint32_t, std::pair<uint32_t, uint32_t>> stageSpans; //stage bit -> [begin, end)
+	for (const auto& range : declared)
+	{
+		for (uint32_t bit = 0; bit < 32; ++bit)
+		{
+			uint32_t stage = 1u << bit;
+			if (!(range.stageFlags & stage))
+				continue;
+
+			auto span = stageSpans.find(stage);
+			if (span == stageSpans.end())
+				stageSpans[stage] = { range.offset, range.offset + range.size };
+			else
+				span->second = { std::min(span->second.first, range.offset), std::max(span->second.second, range.offset + range.size) };
+		}
+	}
+
+	std::vector<VkPushConstantRange> ranges;
+	for (const auto& span : stageSpans)
+	{
+		uint32_t size = span.second.second - span.second.first;
+
+		auto existing = std::find_if(ranges.begin(), ranges.end(), [&](const VkPushConstantRange& range)
+		{
+			return range.offset == span.second.first && range.size == size;
+		});
+
+		if (existing != ranges.end())
+			existing->stageFlags |= span.first;
+		else
+			ranges.push_back({ span.first, span.second.first, size });
+	}
+
+	std::sort(ranges.begin(), ranges.end(), [](const VkPushConstantRange& a, const VkPushConstantRange& b)
+	{
+		if (a.offset != b.offset) return a.offset < b.offset;
+		if (a.size != b.size) return a.size < b.size;
+		return a.stageFlags < b.stageFlags;
+	});
+
+	return ranges;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "includes.h"
+#include "PipelineKey.h"
+
+struct DescriptorLayoutCacheStats
+{
+	uint32_t descriptorSetLayouts;
+	uint32_t pipelineLayouts;
+	uint64_t hits;
+	uint64_t misses;
+};
+
+//device wide, refcounted descriptor set layouts and pipeline layouts. bindings are sorted by binding index and push
+//constant ranges by offset before keying, so declaration order doesn't matter and pipelines built from the same
+//resource interface get the same VkPipelineLayout, which keeps their descriptor sets bound across pipeline switches
+class DescriptorLayoutCache
+{
+public:
+	DescriptorLayoutCache(VkDevice GPU);
+	~DescriptorLayoutCache();
+
+	VkDescriptorSetLayout AcquireDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags = 0);
+	VkPipelineLayout AcquirePipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+
+	void ReleaseDescriptorSetLayout(VkDescriptorSetLayout setLayout);
+	void ReleasePipelineLayout(VkPipelineLayout layout);
+
+	DescriptorLayoutCacheStats GetStats();
+	void PrintStats();
+
+	void Destroy();
+
+	static std::vector<VkDescriptorSetLayoutBinding> NormalizeBindings(std::vector<VkDescriptorSetLayoutBinding> bindings); //throws on duplicate binding indices
+	static std::vector<VkPushConstantRange> NormalizePushConstantRanges(const std::vector<VkPushConstantRange>& ranges); //one range per stage, stages with the same span share it
+private:
+	KeyedObjectTable<VkDescriptorSetLayout> setLayouts;
+	KeyedObjectTable<VkPipelineLayout> pipelineLayouts;
+
+	uint64_t hits;
+	uint64_t misses;
+
+	std::mutex lock;
+	VkDevice GPU;
+};
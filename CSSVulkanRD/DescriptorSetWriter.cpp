@@ -0,0 +1,229 @@
+#include "DescriptorSetWriter.h"
+
+static bool isImageDescriptor(VkDescriptorType type)
+{
+	return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+		|| type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE || type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+
+static bool isTexelBufferDescriptor(VkDescriptorType type)
+{
+	return type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+}
+
+DescriptorSetWriter::DescriptorSetWriter(VkDevice GPU, VkDescriptorSetLayout layout, const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	this->GPU = GPU;
+	updateTemplate = VK_NULL_HANDLE;
+	elementCount = 0;
+	stats = {};
+
+	std::vector<VkDescriptorUpdateTemplateEntry> entries;
+	for (const auto& binding : bindings)
+	{
+		if (binding.descriptorCount == 0)
+			continue;
+
+		BindingSlot slot{};
+		slot.binding = binding.binding;
+		slot.type = binding.descriptorType;
+		slot.count = binding.descriptorCount;
+		slot.firstElement = elementCount;
+		slots.push_back(slot);
+
+		VkDescriptorUpdateTemplateEntry entry{};
+		entry.dstBinding = binding.binding;
+		entry.dstArrayElement = 0;
+		entry.descriptorCount = binding.descriptorCount;
+		entry.descriptorType = binding.descriptorType;
+		entry.offset = elementCount * sizeof(DescriptorInfo);
+		entry.stride = sizeof(DescriptorInfo);
+		entries.push_back(entry);
+
+		elementCount += binding.descriptorCount;
+	}
+
+	if (entries.empty())
+		return; //nothing to write
+
+	VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+	templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+	templateInfo.pDescriptorUpdateEntries = entries.data();
+	templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	templateInfo.descriptorSetLayout = layout;
+	VULKAN_CALL_ERROR(vkCreateDescriptorUpdateTemplate(GPU, &templateInfo, nullptr, &updateTemplate), "failed to create descriptor update template");
+}
+
+DescriptorSetWriter::~DescriptorSetWriter()
+{
+}
+
+void DescriptorSetWriter::SetBuffer(VkDescriptorSet set, uint32_t binding, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t arrayElement)
+{
+	DescriptorInfo info{};
+	info.buffer.buffer = buffer;
+	info.buffer.offset = offset;
+	info.buffer.range = range;
+	write(set, binding, arrayElement, info);
+}
+
+void DescriptorSetWriter::SetImage(VkDescriptorSet set, uint32_t binding, VkImageView view, VkImageLayout layout, VkSampler sampler, uint32_t arrayElement)
+{
+	DescriptorInfo info{};
+	info.image.imageView = view;
+	info.image.imageLayout = layout;
+	info.image.sampler = sampler;
+	write(set, binding, arrayElement, info);
+}
+
+void DescriptorSetWriter::SetTexelBuffer(VkDescriptorSet set, uint32_t binding, VkBufferView view, uint32_t arrayElement)
+{
+	DescriptorInfo info{};
+	info.texelBuffer = view;
+	write(set, binding, arrayElement, info);
+}
+
+void DescriptorSetWriter::Flush(VkDescriptorSet set)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	auto it = sets.find(set);
+	if (it != sets.end() && it->second.anyDirty)
+		flushSet(set, it->second);
+}
+
+void DescriptorSetWriter::Flush()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	for (auto& entry : sets)
+	{
+		if (entry.second.anyDirty)
+			flushSet(entry.first, entry.second);
+	}
+}
+
+void DescriptorSetWriter::Forget(VkDescriptorSet set)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	sets.erase(set);
+}
+
+DescriptorWriteStats DescriptorSetWriter::GetStats()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	return stats;
+}
+
+void DescriptorSetWriter::Destroy()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	if (updateTemplate != VK_NULL_HANDLE)
+		vkDestroyDescriptorUpdateTemplate(GPU, updateTemplate, nullptr);
+
+	updateTemplate = VK_NULL_HANDLE;
+	sets.clear();
+}
+
+const DescriptorSetWriter::BindingSlot& DescriptorSetWriter::findSlot(uint32_t binding, uint32_t arrayElement) const
+{
+	for (const auto& slot : slots)
+	{
+		if (slot.binding == binding)
+		{
+			if (arrayElement >= slot.count)
+				throw std::runtime_error("descriptor write past the end of binding " + std::to_string(binding));
+			return slot;
+		}
+	}
+
+	throw std::runtime_error("descriptor write to binding " + std::to_string(binding) + " which isn't in the set layout");
+}
+
+DescriptorSetWriter::SetState& DescriptorSetWriter::getState(VkDescriptorSet set)
+{
+	auto it = sets.find(set);
+	if (it != sets.end())
+		return it->second;
+
+	SetState& state = sets[set];
+	state.payload.resize(elementCount, DescriptorInfo{});
+	state.written.resize(elementCount, 0);
+	state.dirty.resize(elementCount, 0);
+	state.anyDirty = false;
+	state.writtenCount = 0;
+	return state;
+}
+
+void DescriptorSetWriter::write(VkDescriptorSet set, uint32_t binding, uint32_t arrayElement, const DescriptorInfo& info)
+{
+	if (set == VK_NULL_HANDLE)
+		throw std::runtime_error("descriptor set not allocated, call Build first");
+
+	std::lock_guard<std::mutex> _lock(lock);
+
+	const BindingSlot& slot = findSlot(binding, arrayElement);
+	SetState& state = getState(set);
+	uint32_t element = slot.firstElement + arrayElement;
+
+	//the union is zeroed before filling, so comparing bytes is comparing the descriptor
+	if (state.written[element] && memcmp(&state.payload[element], &info, sizeof(DescriptorInfo)) == 0)
+	{
+		stats.writesSkipped++;
+		return;
+	}
+
+	state.payload[element] = info;
+	if (!state.written[element])
+	{
+		state.written[element] = 1;
+		state.writtenCount++;
+	}
+	state.dirty[element] = 1;
+	state.anyDirty = true;
+}
+
+void DescriptorSetWriter::flushSet(VkDescriptorSet set, SetState& state)
+{
+	if (state.writtenCount == elementCount)
+	{
+		vkUpdateDescriptorSetWithTemplate(GPU, set, updateTemplate, state.payload.data());
+		stats.templateUpdates++;
+	}
+	else
+	{
+		//a template writes every binding, unwritten ones would hand the driver garbage. write just what we have
+		std::vector<VkWriteDescriptorSet> writes;
+		for (const auto& slot : slots)
+		{
+			for (uint32_t i = 0; i < slot.count; ++i)
+			{
+				uint32_t element = slot.firstElement + i;
+				if (!state.dirty[element])
+					continue;
+
+				VkWriteDescriptorSet write{};
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = set;
+				write.dstBinding = slot.binding;
+				write.dstArrayElement = i;
+				write.descriptorType = slot.type;
+				write.descriptorCount = 1;
+				if (isImageDescriptor(slot.type)) write.pImageInfo = &state.payload[element].image;
+				else if (isTexelBufferDescriptor(slot.type)) write.pTexelBufferView = &state.payload[element].texelBuffer;
+				else write.pBufferInfo = &state.payload[element].buffer;
+				writes.push_back(write);
+			}
+		}
+
+		vkUpdateDescriptorSets(GPU, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		stats.partialUpdates++;
+	}
+
+	std::fill(state.dirty.begin(), state.dirty.end(), 0);
+	state.anyDirty = false;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "includes.h"
+#include <unordered_map>
+
+struct DescriptorWriteStats
+{
+	uint64_t writesSkipped;   //identical to what the set already holds
+	uint64_t templateUpdates; //whole set in one vkUpdateDescriptorSetWithTemplate
+	uint64_t partialUpdates;  //vkUpdateDescriptorSets with just the changed bindings, set not fully written yet
+};
+
+//shadows the contents of every descriptor set of one layout and applies writes lazily. Set* calls only record the
+//descriptor and drop it when nothing changed, Flush pushes the changes with one templated update per set
+class DescriptorSetWriter
+{
+public:
+	DescriptorSetWriter(VkDevice GPU, VkDescriptorSetLayout layout, const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+	~DescriptorSetWriter();
+
+	void SetBuffer(VkDescriptorSet set, uint32_t binding, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range, uint32_t arrayElement = 0);
+	void SetImage(VkDescriptorSet set, uint32_t binding, VkImageView view, VkImageLayout layout, VkSampler sampler = VK_NULL_HANDLE, uint32_t arrayElement = 0);
+	void SetTexelBuffer(VkDescriptorSet set, uint32_t binding, VkBufferView view, uint32_t arrayElement = 0);
+
+	void Flush(VkDescriptorSet set); //must happen before the set is bound
+	void Flush();
+	void Forget(VkDescriptorSet set); //the set was freed
+
+	DescriptorWriteStats GetStats();
+
+	void Destroy();
+private:
+	//one template entry per array element, all the same size so the payload is a flat array
+	union DescriptorInfo
+	{
+		VkDescriptorBufferInfo buffer;
+		VkDescriptorImageInfo image;
+		VkBufferView texelBuffer;
+	};
+
+	struct BindingSlot
+	{
+		uint32_t binding;
+		VkDescriptorType type;
+		uint32_t count;
+		uint32_t firstElement; //index into the payload
+	};
+
+	struct SetState
+	{
+		std::vector<DescriptorInfo> payload;
+		std::vector<uint8_t> written; //element has a valid descriptor
+		std::vector<uint8_t> dirty;
+		bool anyDirty;
+		uint32_t writtenCount;
+	};
+
+	const BindingSlot& findSlot(uint32_t binding, uint32_t arrayElement) const;
+	SetState& getState(VkDescriptorSet set);
+	void write(VkDescriptorSet set, uint32_t binding, uint32_t arrayElement, const DescriptorInfo& info);
+	void flushSet(VkDescriptorSet set, SetState& state);
+
+	std::vector<BindingSlot> slots;
+	uint32_t elementCount;
+	VkDescriptorUpdateTemplate updateTemplate;
+
+	std::unordered_map<VkDescriptorSet, SetState> sets;
+	DescriptorWriteStats stats;
+
+	std::mutex lock;
+	VkDevice GPU;
+};
@@ -1,8 +1,13 @@
 #include "DeviceContext.h"
 #include "includes.h"
+#include "GPUQueue.h"
+#include "ComputePipelineState.h"
 
 DeviceContext::DeviceContext()
 {
+    currentFrame = 0;
+    pQueue = nullptr;
+    GPU = VK_NULL_HANDLE;
 }
 
 DeviceContext::~DeviceContext()
@@ -11,116 +16,306 @@ DeviceContext::~DeviceContext()
 
 CommandBuffer* DeviceContext::GetCommandBuffer(bool begin)
 {
-    if (commandBufferPool.size() == 0)
+    CommandArena* pArena = getArena();
+
+    CommandBuffer* buffer;
+    if (pArena->next < pArena->commandBuffers.size())
+        buffer = pArena->commandBuffers[pArena->next];
+    else
+        buffer = createCommandBuffer(pArena);
+
+    pArena->next++;
+
+    if (begin)
     {
-        auto cb = createCommandBuffer(begin);
-        return cb;
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VULKAN_CALL_ERROR(vkBeginCommandBuffer(buffer->handle, &beginInfo), "failed to begin command buffer");
     }
+    buffer->ResetPushConstants();
+    return buffer;
+}
+
+CommandBuffer* DeviceContext::GetSecondaryCommandBuffer(const VkCommandBufferInheritanceInfo& inheritance)
+{
+    CommandArena* pArena = getArena();
+
+    CommandBuffer* buffer;
+    if (pArena->nextSecondary < pArena->secondaryCommandBuffers.size())
+        buffer = pArena->secondaryCommandBuffers[pArena->nextSecondary];
     else
+        buffer = createCommandBuffer(pArena, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+    pArena->nextSecondary++;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+    VULKAN_CALL_ERROR(vkBeginCommandBuffer(buffer->handle, &beginInfo), "failed to begin secondary command buffer");
+    buffer->ResetPushConstants();
+
+    return buffer;
+}
+
+uint64_t DeviceContext::SubmitCommandBuffer(CommandBuffer* commandBuffer, bool block)
+{
+    uint64_t value = pQueue->Submit(1, &commandBuffer->handle);
+
+    if (block) pQueue->Wait(value);
+    return value;
+}
+
+uint64_t DeviceContext::SubmitCommandBuffer(CommandBuffer* commandBuffer, const std::vector<SemaphoreWait>& waits, bool block)
+{
+    uint64_t value = pQueue->Submit(1, &commandBuffer->handle, waits);
+
+    if (block) pQueue->Wait(value);
+    return value;
+}
+
+void DeviceContext::BindComputePipeline(CommandBuffer* commandBuffer, ComputePipelineState* pPipeline)
+{
+    vkCmdBindPipeline(commandBuffer->handle, VK_PIPELINE_BIND_POINT_COMPUTE, pPipeline->GetPipeline());
+    commandBuffer->ResetPushConstants(); //an incompatible layout disturbs the pushed values, the shadow can't tell
+
+    VkDescriptorSet descriptorSet = pPipeline->GetDescriptorSet(currentFrame);
+    if (descriptorSet != VK_NULL_HANDLE)
+        vkCmdBindDescriptorSets(commandBuffer->handle, VK_PIPELINE_BIND_POINT_COMPUTE, pPipeline->GetPipelineLayout(), 0, 1, &descriptorSet, 0, nullptr);
+}
+
+void DeviceContext::Dispatch(CommandBuffer* commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+    vkCmdDispatch(commandBuffer->handle, groupCountX, groupCountY, groupCountZ);
+}
+
+void DeviceContext::DispatchIndirect(CommandBuffer* commandBuffer, VkBuffer argumentBuffer, VkDeviceSize offset)
+{
+    vkCmdDispatchIndirect(commandBuffer->handle, argumentBuffer, offset);
+}
+
+void DeviceContext::PushConstants(CommandBuffer* commandBuffer, VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* pData)
+{
+    assert(offset % 4 == 0 && size % 4 == 0 && offset + size <= MAX_PUSH_CONSTANT_SIZE);
+
+    PushConstantShadow& shadow = commandBuffer->pushConstants;
+    if (shadow.layout != layout)
     {
-        for (CommandBuffer* buffer : commandBufferPool)
+        shadow.layout = layout;
+        memset(shadow.written, 0, sizeof(shadow.written));
+    }
+
+    //narrow the push down to the span between the first and last changed byte
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+    uint32_t first = size;
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        uint32_t byte = offset + i;
+        if (!shadow.written[byte] || shadow.data[byte] != pBytes[i])
         {
-            if (vkGetFenceStatus(GPU, buffer->fence) == VK_SUCCESS)
-            {
-                if (begin)
-                {
-                    VkCommandBufferBeginInfo beginInfo{};
-                    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-                    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-                    VULKAN_CALL_ERROR(vkBeginCommandBuffer(buffer->handle, &beginInfo), "failed to begin command buffer");
-                }
-                return buffer;
-            }
+            if (first == size) first = i;
+            last = i;
         }
-
-        //all command buffers are busy executing, new command buffer required
-        auto cb = createCommandBuffer(begin);
-        return cb;
     }
+
+    if (first == size)
+        return; //nothing changed
+
+    //offset and size of vkCmdPushConstants must be multiples of 4
+    first &= ~3u;
+    last = std::min((last & ~3u) + 4, size);
+
+    memcpy(shadow.data + offset + first, pBytes + first, last - first);
+    memset(shadow.written + offset + first, 1, last - first);
+
+    vkCmdPushConstants(commandBuffer->handle, layout, stages, offset + first, last - first, pBytes + first);
 }
 
-void DeviceContext::SubmitCommandBuffer(CommandBuffer* commandBuffer, bool block)
+void DeviceContext::SetViewport(CommandBuffer* commandBuffer, const VkViewport& viewport)
 {
-    VkSubmitInfo submit{};
-    submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit.commandBufferCount = 1;
-    submit.pCommandBuffers = &commandBuffer->handle;
+    vkCmdSetViewport(commandBuffer->handle, 0, 1, &viewport);
+}
 
-    vkResetFences(GPU, 1, &commandBuffer->fence);
-    vkQueueSubmit(gpuQueue, 1, &submit, commandBuffer->fence);
+void DeviceContext::SetScissor(CommandBuffer* commandBuffer, const VkRect2D& scissor)
+{
+    vkCmdSetScissor(commandBuffer->handle, 0, 1, &scissor);
+}
 
-    if (block) vkQueueWaitIdle(gpuQueue);
+void DeviceContext::SetCullMode(CommandBuffer* commandBuffer, VkCullModeFlags cullMode)
+{
+#ifdef VK_EXT_extended_dynamic_state
+    if (pExtendedDynamicState)
+        pExtendedDynamicState->vkCmdSetCullMode(commandBuffer->handle, cullMode);
+#endif
 }
 
-void DeviceContext::SubmitCommandBuffer(CommandBuffer* commandBuffer, VkFence* outPFence)
+void DeviceContext::SetFrontFace(CommandBuffer* commandBuffer, VkFrontFace frontFace)
 {
-    VkSubmitInfo submit{};
-    submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit.commandBufferCount = 1;
-    submit.pCommandBuffers = &commandBuffer->handle;
-    vkResetFences(GPU, 1, &commandBuffer->fence);
-    vkQueueSubmit(gpuQueue, 1, &submit, commandBuffer->fence);
-    outPFence = &commandBuffer->fence;
+#ifdef VK_EXT_extended_dynamic_state
+    if (pExtendedDynamicState)
+        pExtendedDynamicState->vkCmdSetFrontFace(commandBuffer->handle, frontFace);
+#endif
 }
 
-void DeviceContext::SetQueue(VkQueue queue)
+void DeviceContext::SetPrimitiveTopology(CommandBuffer* commandBuffer, VkPrimitiveTopology topology)
 {
-    gpuQueue = queue;
+#ifdef VK_EXT_extended_dynamic_state
+    if (pExtendedDynamicState)
+        pExtendedDynamicState->vkCmdSetPrimitiveTopology(commandBuffer->handle, topology);
+#endif
 }
 
-void DeviceContext::Create(VkDevice GPU, uint32_t queueFamily, bool transientCommandPool)
+void DeviceContext::SetDepthTestEnable(CommandBuffer* commandBuffer, VkBool32 enable)
 {
-    this->GPU = GPU;
+#ifdef VK_EXT_extended_dynamic_state
+    if (pExtendedDynamicState)
+        pExtendedDynamicState->vkCmdSetDepthTestEnable(commandBuffer->handle, enable);
+#endif
+}
 
-    VkCommandPoolCreateInfo cpci{};
-    cpci.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    cpci.queueFamilyIndex = queueFamily;
+void DeviceContext::SetDepthWriteEnable(CommandBuffer* commandBuffer, VkBool32 enable)
+{
+#ifdef VK_EXT_extended_dynamic_state
+    if (pExtendedDynamicState)
+        pExtendedDynamicState->vkCmdSetDepthWriteEnable(commandBuffer->handle, enable);
+#endif
+}
+
+void DeviceContext::SetDepthCompareOp(CommandBuffer* commandBuffer, VkCompareOp compareOp)
+{
+#ifdef VK_EXT_extended_dynamic_state
+    if (pExtendedDynamicState)
+        pExtendedDynamicState->vkCmdSetDepthCompareOp(commandBuffer->handle, compareOp);
+#endif
+}
 
-    cpci.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+void DeviceContext::SetExtendedDynamicState(const ExtendedDynamicStateFunctions* pFunctions)
+{
+    pExtendedDynamicState = pFunctions;
+}
 
-    if (transientCommandPool)
-        cpci.flags |= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+bool DeviceContext::HasExtendedDynamicState() const
+{
+    return pExtendedDynamicState != nullptr;
+}
 
-    VULKAN_CALL_ERROR(vkCreateCommandPool(GPU, &cpci, nullptr, &commandPool), "failed to create command pool");
+void DeviceContext::AdvanceFrame()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    //everything this context submitted so far is covered by the queue's latest timeline point
+    frames[currentFrame].retireValue = pQueue->GetLastSubmittedValue();
+
+    currentFrame = (currentFrame + 1) % frames.size();
+    ContextFrame& frame = frames[currentFrame];
+
+    pQueue->Wait(frame.retireValue);
+
+    for (auto& entry : frame.arenas)
+    {
+        VULKAN_CALL_ERROR(vkResetCommandPool(GPU, entry.second->pool, 0), "failed to reset command pool");
+        entry.second->next = 0;
+        entry.second->nextSecondary = 0;
+    }
 }
 
-void DeviceContext::Destroy()
+void DeviceContext::SetQueue(GPUQueue* pQueue)
 {
-    vkDestroyCommandPool(GPU, commandPool, nullptr);
+    this->pQueue = pQueue;
+}
+
+GPUQueue* DeviceContext::GetQueue() const
+{
+    return pQueue;
+}
+
+uint32_t DeviceContext::GetFrameIndex() const
+{
+    return currentFrame;
+}
 
-    for (int i = 0; i < commandBufferPool.size(); ++i)
+void DeviceContext::Create(VkDevice GPU, uint32_t queueFamily, bool transientCommandPool, uint32_t framesInFlight)
+{
+    this->GPU = GPU;
+    this->queueFamily = queueFamily;
+    this->transientCommandPool = transientCommandPool;
+
+    frames.resize(framesInFlight);
+    currentFrame = 0;
+
+    for (ContextFrame& frame : frames)
+        frame.retireValue = 0; //nothing in flight yet, first wait must not block
+}
+
+void DeviceContext::Destroy()
+{
+    for (ContextFrame& frame : frames)
     {
-        vkDestroyFence(GPU, commandBufferPool[i]->fence, nullptr);
+        for (auto& entry : frame.arenas)
+        {
+            vkDestroyCommandPool(GPU, entry.second->pool, nullptr); //frees the command buffers with it
 
-        commandBufferPool.erase(commandBufferPool.begin() + i);
+            for (CommandBuffer* buffer : entry.second->commandBuffers)
+                delete buffer;
+            for (CommandBuffer* buffer : entry.second->secondaryCommandBuffers)
+                delete buffer;
+            delete entry.second;
+        }
+        frame.arenas.clear();
     }
+    frames.clear();
+}
+
+CommandArena* DeviceContext::getArena()
+{
+    std::lock_guard<std::mutex> lock(_lock);
+
+    auto& arenas = frames[currentFrame].arenas;
+    auto it = arenas.find(std::this_thread::get_id());
+    if (it != arenas.end())
+        return it->second;
+
+    CommandArena* pArena = createArena();
+    arenas[std::this_thread::get_id()] = pArena;
+    return pArena;
 }
 
-CommandBuffer* DeviceContext::createCommandBuffer(bool begin)
+CommandArena* DeviceContext::createArena()
+{
+    CommandArena* pArena = new CommandArena();
+    pArena->next = 0;
+    pArena->nextSecondary = 0;
+
+    VkCommandPoolCreateInfo cpci{};
+    cpci.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cpci.queueFamilyIndex = queueFamily;
+
+    //buffers are never reset individually, the pool is reset wholesale
+    if (transientCommandPool)
+        cpci.flags |= VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    VULKAN_CALL_ERROR(vkCreateCommandPool(GPU, &cpci, nullptr, &pArena->pool), "failed to create command pool");
+    return pArena;
+}
+
+CommandBuffer* DeviceContext::createCommandBuffer(CommandArena* pArena, VkCommandBufferLevel level)
 {
     CommandBuffer* newBuffer = new CommandBuffer();
+    newBuffer->ResetPushConstants();
 
     VkCommandBufferAllocateInfo cbai{};
     cbai.commandBufferCount = 1;
-    cbai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cbai.level = level;
     cbai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    cbai.commandPool = commandPool;
+    cbai.commandPool = pArena->pool;
 
     VULKAN_CALL_ERROR(vkAllocateCommandBuffers(GPU, &cbai, &newBuffer->handle), "failed to allocate command buffer");
+    if (level == VK_COMMAND_BUFFER_LEVEL_PRIMARY)
+        pArena->commandBuffers.push_back(newBuffer);
+    else
+        pArena->secondaryCommandBuffers.push_back(newBuffer);
 
-    VkFenceCreateInfo fci{};
-    fci.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    VULKAN_CALL_ERROR(vkCreateFence(GPU, &fci, nullptr, &newBuffer->fence), "failed to create command buffer fence");
-    commandBufferPool.push_back(newBuffer);
-
-    if (begin)
-    {
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-        VULKAN_CALL_ERROR(vkBeginCommandBuffer(newBuffer->handle, &beginInfo), "failed to begin command buffer");
-
-        return newBuffer;
-    }
     return newBuffer;
-}
\ No newline at end of file
+}
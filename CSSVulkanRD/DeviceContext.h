@@ -2,24 +2,80 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <type_traits>
+#include "GPUQueue.h"
+
+const uint32_t MAX_PUSH_CONSTANT_SIZE = 256; //shadow size, the largest maxPushConstantsSize in practice
+
+//last push constant bytes recorded into a command buffer, so repeated pushes only send what changed.
+//only valid for one pipeline layout, a different layout starts over
+struct PushConstantShadow
+{
+    VkPipelineLayout layout;
+    uint8_t data[MAX_PUSH_CONSTANT_SIZE];
+    uint8_t written[MAX_PUSH_CONSTANT_SIZE];
+};
 
 struct CommandBuffer
 {
     VkCommandBuffer handle;
-    VkFence fence;
+    PushConstantShadow pushConstants;
+
+    void ResetPushConstants() { pushConstants.layout = VK_NULL_HANDLE; } //call when (re)beginning the buffer and on every pipeline bind
+};
+
+class ComputePipelineState;
+class FrameAllocator;
+class DescriptorAllocator;
+
+//VK_EXT_extended_dynamic_state entry points, loaded by GraphicsDevice when the extension is enabled.
+//empty against headers older than the extension, the Set* calls are no-ops then
+struct ExtendedDynamicStateFunctions
+{
+#ifdef VK_EXT_extended_dynamic_state
+    PFN_vkCmdSetCullModeEXT         vkCmdSetCullMode;
+    PFN_vkCmdSetFrontFaceEXT        vkCmdSetFrontFace;
+    PFN_vkCmdSetPrimitiveTopologyEXT vkCmdSetPrimitiveTopology;
+    PFN_vkCmdSetDepthTestEnableEXT  vkCmdSetDepthTestEnable;
+    PFN_vkCmdSetDepthWriteEnableEXT vkCmdSetDepthWriteEnable;
+    PFN_vkCmdSetDepthCompareOpEXT   vkCmdSetDepthCompareOp;
+#endif
 };
 
 struct InflightFrame
 {
     CommandBuffer* cmdBuffer;
+    uint64_t        timelineValue; //graphics queue timeline point of this frame's submission
 
     VkSemaphore     imageAvailable;
     VkSemaphore     renderFinished;
     uint32_t        frameIndex;
 
+    FrameAllocator*  pAllocator;     //transient uniform/vertex/index data, reset when the frame is reused
+    DescriptorAllocator* pDescriptors; //transient descriptor sets, reset along with the allocator
+
     void* pPerFrameData;
 };
 
+//command buffers handed out linearly from one pool per thread, the whole pool is reset at once when its frame comes back around
+struct CommandArena
+{
+    VkCommandPool pool;
+    std::vector<CommandBuffer*> commandBuffers;
+    uint32_t next;
+
+    std::vector<CommandBuffer*> secondaryCommandBuffers;
+    uint32_t nextSecondary;
+};
+
+struct ContextFrame
+{
+    uint64_t retireValue; //queue timeline point covering every submission made on this context during the frame
+    std::unordered_map<std::thread::id, CommandArena*> arenas;
+};
+
 class DeviceContext
 {
 public:
@@ -27,21 +83,64 @@ public:
     ~DeviceContext();
 
     CommandBuffer* GetCommandBuffer(bool begin = false);
-    void SubmitCommandBuffer(CommandBuffer* commandBuffer, bool block = false);
-    void SubmitCommandBuffer(CommandBuffer* commandBuffer, VkFence* outPFence);
+    CommandBuffer* GetSecondaryCommandBuffer(const VkCommandBufferInheritanceInfo& inheritance); //returned already begun, continuing the inherited render pass
+    uint64_t SubmitCommandBuffer(CommandBuffer* commandBuffer, bool block = false); //returns the queue timeline point to wait on
+    uint64_t SubmitCommandBuffer(CommandBuffer* commandBuffer, const std::vector<SemaphoreWait>& waits, bool block = false); //waits are usually another queue's GPUQueue::WaitFor
+
+    //compute recording, the pipeline's descriptor set for the context's current frame slot is bound along with it
+    void BindComputePipeline(CommandBuffer* commandBuffer, ComputePipelineState* pPipeline);
+    void Dispatch(CommandBuffer* commandBuffer, uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1);
+    void DispatchIndirect(CommandBuffer* commandBuffer, VkBuffer argumentBuffer, VkDeviceSize offset = 0); //argumentBuffer holds a VkDispatchIndirectCommand
+
+    //dynamic graphics state. viewport and scissor are always dynamic, the rest only when the device has extended
+    //dynamic state and the bound PipelineState enabled it, otherwise they are ignored and the baked value applies
+    void SetViewport(CommandBuffer* commandBuffer, const VkViewport& viewport);
+    void SetScissor(CommandBuffer* commandBuffer, const VkRect2D& scissor);
+    void SetCullMode(CommandBuffer* commandBuffer, VkCullModeFlags cullMode);
+    void SetFrontFace(CommandBuffer* commandBuffer, VkFrontFace frontFace);
+    void SetPrimitiveTopology(CommandBuffer* commandBuffer, VkPrimitiveTopology topology); //must stay in the topology class the pipeline was built with
+    void SetDepthTestEnable(CommandBuffer* commandBuffer, VkBool32 enable);
+    void SetDepthWriteEnable(CommandBuffer* commandBuffer, VkBool32 enable);
+    void SetDepthCompareOp(CommandBuffer* commandBuffer, VkCompareOp compareOp);
+
+    //push constants. only bytes that differ from the last push on this command buffer are recorded, identical pushes
+    //record nothing. ranges must lie inside the layout's push constant ranges for stages
+    void PushConstants(CommandBuffer* commandBuffer, VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* pData);
+    template<typename T>
+    void PushConstants(CommandBuffer* commandBuffer, VkPipelineLayout layout, VkShaderStageFlags stages, const T& data, uint32_t offset = 0)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "push constants are copied byte for byte");
+        static_assert(sizeof(T) <= MAX_PUSH_CONSTANT_SIZE, "push constant block too large");
+        PushConstants(commandBuffer, layout, stages, offset, static_cast<uint32_t>(sizeof(T)), &data);
+    }
 
-    void SetQueue(VkQueue queue);
+    void SetExtendedDynamicState(const ExtendedDynamicStateFunctions* pFunctions); //nullptr when unsupported
+    bool HasExtendedDynamicState() const;
 
-    void Create(VkDevice GPU, uint32_t queueFamily, bool transientCommandPool = false);
+    void AdvanceFrame(); //retire the current frame and recycle the arenas of the oldest one
+
+    void SetQueue(GPUQueue* pQueue);
+    GPUQueue* GetQueue() const;
+    uint32_t GetFrameIndex() const; //slot in [0, framesInFlight), index per frame resources with it
+
+    void Create(VkDevice GPU, uint32_t queueFamily, bool transientCommandPool = false, uint32_t framesInFlight = 2);
     void Destroy();
 
 private:
-    VkCommandPool commandPool;
-    std::vector<CommandBuffer*> commandBufferPool;
-    CommandBuffer* createCommandBuffer(bool start);
+    std::vector<ContextFrame> frames;
+    uint32_t currentFrame;
+
+    uint32_t queueFamily;
+    bool transientCommandPool;
 
-    VkQueue  gpuQueue;
+    CommandArena* getArena();
+    CommandArena* createArena();
+    CommandBuffer* createCommandBuffer(CommandArena* pArena, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+    GPUQueue* pQueue;
     VkDevice GPU;
 
+    const ExtendedDynamicStateFunctions* pExtendedDynamicState = nullptr;
+
     std::mutex _lock;
-};
\ No newline at end of file
+};
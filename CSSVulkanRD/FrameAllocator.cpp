@@ -0,0 +1,76 @@
+#include "FrameAllocator.h"
+#include "GPUBuffer.h"
+
+FrameAllocator::FrameAllocator(GraphicsDevice* pDevice)
+{
+	this->pDevice = pDevice;
+	pBuffer = nullptr;
+	pMapped = nullptr;
+	capacity = 0;
+	minAlignment = 1;
+	head = 0;
+}
+
+FrameAllocator::~FrameAllocator()
+{
+}
+
+void FrameAllocator::Create(VkDeviceSize capacity, VkBufferUsageFlags usage, VkDeviceSize minAlignment)
+{
+	this->capacity = capacity;
+	this->minAlignment = std::max<VkDeviceSize>(minAlignment, 1);
+	head = 0;
+
+	pBuffer = new GPUBuffer(pDevice);
+	pBuffer->Create((size_t)capacity, (VkBufferUsageFlagBits)usage, VK_SHARING_MODE_EXCLUSIVE, true);
+
+	pMapped = (uint8_t*)pBuffer->Map(); //host coherent, stays mapped for the allocator's lifetime
+	if (!pMapped)
+		throw std::runtime_error("failed to map frame allocator buffer");
+}
+
+void FrameAllocator::Destroy()
+{
+	if (pBuffer)
+	{
+		pBuffer->UnMap();
+		delete pBuffer; //GPUBuffer destroys itself
+		pBuffer = nullptr;
+	}
+	pMapped = nullptr;
+}
+
+FrameAllocation FrameAllocator::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	VkDeviceSize align = std::max(alignment, minAlignment);
+
+	VkDeviceSize offset = head.load(std::memory_order_relaxed);
+	VkDeviceSize aligned;
+	do
+	{
+		aligned = (offset + align - 1) / align * align;
+		if (aligned + size > capacity)
+			throw std::runtime_error("frame allocator out of memory");
+	} while (!head.compare_exchange_weak(offset, aligned + size, std::memory_order_relaxed));
+
+	FrameAllocation allocation;
+	allocation.buffer = pBuffer->GetBuffer();
+	allocation.offset = aligned;
+	allocation.pData = pMapped + aligned;
+	return allocation;
+}
+
+void FrameAllocator::Reset()
+{
+	head = 0;
+}
+
+VkDeviceSize FrameAllocator::GetUsed() const
+{
+	return head;
+}
+
+VkDeviceSize FrameAllocator::GetCapacity() const
+{
+	return capacity;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "includes.h"
+#include <atomic>
+
+class GraphicsDevice;
+class GPUBuffer;
+
+struct FrameAllocation
+{
+	VkBuffer buffer;
+	VkDeviceSize offset;
+	void* pData; //persistently mapped, write only
+};
+
+//linear allocator over one persistently mapped buffer. allocations live until Reset, which the owning frame
+//calls once the gpu has retired it, so there is nothing to free individually
+class FrameAllocator
+{
+public:
+	FrameAllocator(GraphicsDevice* pDevice);
+	~FrameAllocator();
+
+	void Create(VkDeviceSize capacity, VkBufferUsageFlags usage, VkDeviceSize minAlignment = 16);
+	void Destroy();
+
+	FrameAllocation Allocate(VkDeviceSize size, VkDeviceSize alignment = 0); //thread safe
+	void Reset();
+
+	VkDeviceSize GetUsed() const;
+	VkDeviceSize GetCapacity() const;
+private:
+	GraphicsDevice* pDevice;
+	GPUBuffer* pBuffer;
+	uint8_t* pMapped;
+
+	VkDeviceSize capacity;
+	VkDeviceSize minAlignment;
+	std::atomic<VkDeviceSize> head;
+};
@@ -29,6 +29,7 @@ GPUBuffer::GPUBuffer(GraphicsDevice* pDevice) : GPUResource(pDevice)
 	mapped = false;
 	mappable = false;
 	dynamic = false;
+	stagingBuffer = VK_NULL_HANDLE; //dynamic buffers never get one, Destroy checks it
 }
 
 GPUBuffer::~GPUBuffer()
@@ -183,7 +184,7 @@ DynamicPerFrameGPUBuffer::~DynamicPerFrameGPUBuffer()
 	for (int i = 0; i < buffers.size(); ++i)
 	{
 		buffers[i]->GPUBuffer->Destroy();
-		buffers[i]->pBufferOpFence = nullptr;
+		buffers[i]->bufferOpTimelineValue = 0;
 	}
 }
 
@@ -197,7 +198,7 @@ void DynamicPerFrameGPUBuffer::Create(uint32_t bufferCount, uint32_t bufferSize,
 	for (int i = 0; i < bufferCount; ++i)
 	{
 		auto buffer = std::make_shared<GPUBufferContainer>();
-		buffer->pBufferOpFence = nullptr;
+		buffer->bufferOpTimelineValue = 0;
 
 		buffer->GPUBuffer = new GPUBuffer(pDevice);
 		buffer->GPUBuffer->Create(bufferSize, bufferUsage, VK_SHARING_MODE_EXCLUSIVE, true);
@@ -44,8 +44,7 @@ private:
 struct GPUBufferContainer
 {
 	GPUBuffer* GPUBuffer;
-	VkFence* pBufferOpFence; //pointer to the current fence associated
-	//with the gpu operation that uses this buffer
+	uint64_t bufferOpTimelineValue; //queue timeline point of the last gpu operation that uses this buffer
 };
 
 
@@ -0,0 +1,285 @@
+#include "GPUQueue.h"
+
+GPUQueue::GPUQueue()
+{
+    GPU = VK_NULL_HANDLE;
+    queue = VK_NULL_HANDLE;
+    queueFamily = 0;
+    timeline = VK_NULL_HANDLE;
+    lastSubmitted = 0;
+    lastFlushed = 0;
+    lastCompleted = 0;
+    frameStats = {};
+}
+
+GPUQueue::~GPUQueue()
+{
+}
+
+void GPUQueue::Create(VkDevice GPU, VkQueue queue, uint32_t queueFamily)
+{
+    this->GPU = GPU;
+    this->queue = queue;
+    this->queueFamily = queueFamily;
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    VULKAN_CALL_ERROR(vkCreateSemaphore(GPU, &semaphoreInfo, nullptr, &timeline), "failed to create queue timeline semaphore");
+}
+
+void GPUQueue::Destroy()
+{
+    if (timeline != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(GPU, timeline, nullptr);
+        timeline = VK_NULL_HANDLE;
+    }
+}
+
+uint64_t GPUQueue::Submit(uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers, const std::vector<SemaphoreWait>& waits, const std::vector<VkSemaphore>& binarySignals)
+{
+    std::lock_guard<std::mutex> _lock(lock);
+
+    //command buffers without waits can ride along in the previous batch, as long as that batch doesn't signal anyone early
+    if (!pendingBatches.empty() && waits.empty() && pendingBatches.back().binarySignals.empty())
+    {
+        PendingBatch& batch = pendingBatches.back();
+        batch.commandBuffers.insert(batch.commandBuffers.end(), pCommandBuffers, pCommandBuffers + commandBufferCount);
+        batch.binarySignals = binarySignals;
+    }
+    else
+    {
+        PendingBatch batch;
+        batch.commandBuffers.assign(pCommandBuffers, pCommandBuffers + commandBufferCount);
+        batch.waits = waits;
+        batch.binarySignals = binarySignals;
+        pendingBatches.push_back(std::move(batch));
+    }
+
+    frameStats.batches++;
+    return ++lastSubmitted; //signalled by the flush that contains this batch
+}
+
+uint64_t GPUQueue::Submit(const VkSubmitInfo& submitInfo)
+{
+    //signal list = caller's binary semaphores + our timeline, values array has to line up with it
+    std::vector<VkSemaphore> signalSemaphores(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+    signalSemaphores.push_back(timeline);
+
+    std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+
+    //ours replaces the caller's timeline info, the rest of their chain hangs off it
+    std::vector<uint64_t> waitValues(submitInfo.waitSemaphoreCount, 0);
+    timelineInfo.pNext = submitInfo.pNext;
+    const VkTimelineSemaphoreSubmitInfo* pCallerTimeline = static_cast<const VkTimelineSemaphoreSubmitInfo*>(submitInfo.pNext);
+    if (pCallerTimeline && pCallerTimeline->sType == VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO)
+    {
+        for (uint32_t i = 0; i < pCallerTimeline->waitSemaphoreValueCount && i < waitValues.size(); ++i)
+            waitValues[i] = pCallerTimeline->pWaitSemaphoreValues[i];
+        timelineInfo.pNext = pCallerTimeline->pNext;
+    }
+    for (auto pNext = static_cast<const VkBaseInStructure*>(timelineInfo.pNext); pNext; pNext = pNext->pNext)
+    {
+        if (pNext->sType == VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO)
+            throw std::runtime_error("VkTimelineSemaphoreSubmitInfo must be first in the submit pNext chain"); //can't unlink it from a const chain
+    }
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+
+    VkSubmitInfo submit = submitInfo;
+    submit.pNext = &timelineInfo;
+    submit.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+    submit.pSignalSemaphores = signalSemaphores.data();
+
+    std::lock_guard<std::mutex> _lock(lock);
+
+    flushLocked(); //keep queue order, anything batched earlier goes first
+
+    uint64_t value = lastSubmitted + 1;
+    signalValues.back() = value;
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+    VULKAN_CALL_ERROR(vkQueueSubmit(queue, 1, &submit, VK_NULL_HANDLE), "failed to submit to gpu queue");
+    lastSubmitted = value;
+    lastFlushed = value;
+
+    frameStats.batches++;
+    frameStats.queueSubmitCalls++;
+    return value;
+}
+
+void GPUQueue::Flush()
+{
+    std::lock_guard<std::mutex> _lock(lock);
+    flushLocked();
+}
+
+VkResult GPUQueue::Present(const VkPresentInfoKHR& presentInfo)
+{
+    std::lock_guard<std::mutex> _lock(lock);
+    flushLocked(); //the present waits on semaphores signalled by batched work
+    return vkQueuePresentKHR(queue, &presentInfo);
+}
+
+QueueSubmitStats GPUQueue::GetFrameStats()
+{
+    std::lock_guard<std::mutex> _lock(lock);
+    return frameStats;
+}
+
+void GPUQueue::ResetFrameStats()
+{
+    std::lock_guard<std::mutex> _lock(lock);
+    frameStats = {};
+}
+
+void GPUQueue::Wait(uint64_t value)
+{
+    assert(value <= lastSubmitted && "waiting on a timeline value that was never submitted");
+    value = std::min(value, lastSubmitted.load()); //nothing would ever signal it
+
+    if (value <= lastCompleted)
+        return;
+
+    {
+        std::lock_guard<std::mutex> _lock(lock);
+        if (value > lastFlushed)
+            flushLocked(); //waiting on a batch nobody submitted yet would never return
+    }
+
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline;
+    waitInfo.pValues = &value;
+
+    VULKAN_CALL_ERROR(vkWaitSemaphores(GPU, &waitInfo, UINT64_MAX), "failed to wait on queue timeline");
+
+    uint64_t completed = lastCompleted;
+    while (completed < value && !lastCompleted.compare_exchange_weak(completed, value));
+}
+
+bool GPUQueue::IsComplete(uint64_t value)
+{
+    if (value <= lastCompleted)
+        return true;
+
+    return GetCompletedValue() >= value;
+}
+
+void GPUQueue::WaitIdle()
+{
+    Wait(lastSubmitted);
+}
+
+SemaphoreWait GPUQueue::WaitFor(uint64_t value, VkPipelineStageFlags stages) const
+{
+    return { timeline, value, stages };
+}
+
+uint64_t GPUQueue::GetLastSubmittedValue() const
+{
+    return lastSubmitted;
+}
+
+uint64_t GPUQueue::GetCompletedValue()
+{
+    uint64_t value = 0;
+    VULKAN_CALL_ERROR(vkGetSemaphoreCounterValue(GPU, timeline, &value), "failed to query queue timeline");
+
+    uint64_t completed = lastCompleted;
+    while (completed < value && !lastCompleted.compare_exchange_weak(completed, value));
+    return value;
+}
+
+VkQueue GPUQueue::GetQueue() const
+{
+    return queue;
+}
+
+uint32_t GPUQueue::GetQueueFamily() const
+{
+    return queueFamily;
+}
+
+VkSemaphore GPUQueue::GetTimelineSemaphore() const
+{
+    return timeline;
+}
+
+void GPUQueue::flushLocked()
+{
+    if (pendingBatches.empty())
+        return;
+
+    size_t batchCount = pendingBatches.size();
+
+    std::vector<VkSubmitInfo> submits(batchCount);
+    std::vector<VkTimelineSemaphoreSubmitInfo> timelineInfos(batchCount);
+
+    //per batch storage, sized up front so the pointers handed to vulkan stay valid
+    std::vector<std::vector<VkSemaphore>> waitSemaphores(batchCount);
+    std::vector<std::vector<VkPipelineStageFlags>> waitStages(batchCount);
+    std::vector<std::vector<uint64_t>> waitValues(batchCount);
+    std::vector<std::vector<VkSemaphore>> signalSemaphores(batchCount);
+    std::vector<std::vector<uint64_t>> signalValues(batchCount);
+
+    for (size_t i = 0; i < batchCount; ++i)
+    {
+        const PendingBatch& batch = pendingBatches[i];
+
+        for (const SemaphoreWait& wait : batch.waits)
+        {
+            waitSemaphores[i].push_back(wait.semaphore);
+            waitStages[i].push_back(wait.stages);
+            waitValues[i].push_back(wait.value);
+        }
+
+        signalSemaphores[i] = batch.binarySignals;
+        signalValues[i].assign(batch.binarySignals.size(), 0);
+
+        //queue order means the last batch signalling the newest value covers every batch before it
+        if (i == batchCount - 1)
+        {
+            signalSemaphores[i].push_back(timeline);
+            signalValues[i].push_back(lastSubmitted);
+        }
+
+        VkTimelineSemaphoreSubmitInfo& timelineInfo = timelineInfos[i];
+        timelineInfo = {};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues[i].size());
+        timelineInfo.pWaitSemaphoreValues = waitValues[i].data();
+        timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues[i].size());
+        timelineInfo.pSignalSemaphoreValues = signalValues[i].data();
+
+        VkSubmitInfo& submit = submits[i];
+        submit = {};
+        submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit.pNext = &timelineInfo;
+        submit.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores[i].size());
+        submit.pWaitSemaphores = waitSemaphores[i].data();
+        submit.pWaitDstStageMask = waitStages[i].data();
+        submit.commandBufferCount = static_cast<uint32_t>(batch.commandBuffers.size());
+        submit.pCommandBuffers = batch.commandBuffers.data();
+        submit.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores[i].size());
+        submit.pSignalSemaphores = signalSemaphores[i].data();
+    }
+
+    VULKAN_CALL_ERROR(vkQueueSubmit(queue, static_cast<uint32_t>(submits.size()), submits.data(), VK_NULL_HANDLE), "failed to submit to gpu queue");
+
+    lastFlushed = lastSubmitted.load();
+    pendingBatches.clear();
+    frameStats.queueSubmitCalls++;
+}
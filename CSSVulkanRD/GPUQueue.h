@@ -0,0 +1,79 @@
+#pragma once
+#include "includes.h"
+#include <atomic>
+
+//a semaphore (timeline or binary) a submission waits on before the given stages run
+struct SemaphoreWait
+{
+    VkSemaphore          semaphore;
+    uint64_t             value; //ignored for binary semaphores
+    VkPipelineStageFlags stages;
+};
+
+//per frame submission counters, batches is what callers asked for, queueSubmitCalls is what reached the driver
+struct QueueSubmitStats
+{
+    uint32_t batches;
+    uint32_t queueSubmitCalls;
+};
+
+//wraps one VkQueue with one timeline semaphore. every submission signals the next value on the timeline,
+//so "is this work done" becomes a single 64 bit compare instead of a fence per command buffer.
+//submissions are batched and only reach vkQueueSubmit at sync points: Flush, Present, or a Wait on a value that hasn't been flushed yet
+class GPUQueue
+{
+public:
+    GPUQueue();
+    ~GPUQueue();
+
+    void Create(VkDevice GPU, VkQueue queue, uint32_t queueFamily);
+    void Destroy();
+
+    uint64_t Submit(uint32_t commandBufferCount, const VkCommandBuffer* pCommandBuffers,
+        const std::vector<SemaphoreWait>& waits = {}, const std::vector<VkSemaphore>& binarySignals = {}); //batched
+    //flushes pending batches, then submits right away with the timeline signal appended. the caller's pNext chain is kept
+    //behind ours, a VkTimelineSemaphoreSubmitInfo in it has to come first and only its wait values are used
+    uint64_t Submit(const VkSubmitInfo& submitInfo);
+
+    void Flush(); //every pending batch in one vkQueueSubmit
+    VkResult Present(const VkPresentInfoKHR& presentInfo);
+
+    QueueSubmitStats GetFrameStats();
+    void ResetFrameStats();
+
+    void Wait(uint64_t value); //value must have been handed out by Submit already
+    bool IsComplete(uint64_t value);
+    void WaitIdle(); //waits for the last submission, unlike vkQueueWaitIdle it doesn't need the queue lock
+
+    SemaphoreWait WaitFor(uint64_t value, VkPipelineStageFlags stages) const; //for cross queue dependencies
+
+    uint64_t GetLastSubmittedValue() const; //includes batches that haven't been flushed yet
+    uint64_t GetCompletedValue();
+
+    VkQueue GetQueue() const;
+    uint32_t GetQueueFamily() const;
+    VkSemaphore GetTimelineSemaphore() const;
+private:
+    VkDevice GPU;
+    VkQueue queue;
+    uint32_t queueFamily;
+
+    struct PendingBatch
+    {
+        std::vector<VkCommandBuffer> commandBuffers;
+        std::vector<SemaphoreWait> waits;
+        std::vector<VkSemaphore> binarySignals;
+    };
+    std::vector<PendingBatch> pendingBatches;
+
+    QueueSubmitStats frameStats;
+
+    VkSemaphore timeline;
+    std::atomic<uint64_t> lastSubmitted;
+    uint64_t lastFlushed; //guarded by lock
+    std::atomic<uint64_t> lastCompleted; //cached so IsComplete on old values never calls into the driver
+
+    std::mutex lock; //vkQueueSubmit/vkQueuePresentKHR need the queue externally synchronized
+
+    void flushLocked();
+};
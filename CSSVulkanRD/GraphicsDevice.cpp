@@ -4,11 +4,46 @@
 #include "GPUMemoryManager.h"
 #include "DeviceContext.h"
 #include "PipelineState.h"
+#include "ImageViewCache.h"
+#include "SamplerCache.h"
+#include "GPUQueue.h"
+#include "FrameAllocator.h"
+#include "DeferredDeletionQueue.h"
+#include "PresentationController.h"
+#include "PipelineCache.h"
+#include "PipelineStateCache.h"
+#include "DescriptorLayoutCache.h"
+#include "DescriptorAllocator.h"
+#include "BindlessResourceTable.h"
+#include "PipelineManifest.h"
+#include <map>
 
 GraphicsDevice::GraphicsDevice(GLFWwindow* pAppWindow)
 {
+    preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    presentModeChanged = false;
+    presentation = std::make_shared<PresentationController>();
+    swapChain = VK_NULL_HANDLE;
     pApplicationWindow = pAppWindow;
     pipelineDirty = false;
+    headless = false;
+    headlessExtent = {};
+    surface = VK_NULL_HANDLE;
+}
+
+GraphicsDevice::GraphicsDevice(VkExtent2D headlessExtent)
+{
+    preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    presentModeChanged = false;
+    presentation = std::make_shared<PresentationController>();
+    swapChain = VK_NULL_HANDLE;
+    pApplicationWindow = nullptr;
+    pipelineDirty = false;
+    headless = true;
+    this->headlessExtent = headlessExtent;
+    surface = VK_NULL_HANDLE;
 }
 
 GraphicsDevice::~GraphicsDevice()
@@ -20,34 +55,61 @@ void GraphicsDevice::initVulkan()
 {
     createInstance();
     setupDebugMessenger();
-    CreateSurface();
+    if (!headless) CreateSurface();
     PickPhysicalGPU();
+    queryOptionalFeatures();
     createLogicalDevice();
-    createSwapChain();
+
+    GetGPUProperties();
+    initializeMainMemoryManager(); //headless targets allocate through it
+    createObjectCaches();
+
+    if (headless) createHeadlessTargets();
+    else createSwapChain();
     createImageViews();
     createRenderPass();
-    createDescriptorSetLayout();
-    //createGraphicsPipeline();
     createFramebuffers();
     createCommandPools();
-    createDescriptorPool();
-
-    GetGPUProperties();
-    initializeMainMemoryManager();
-
-    auto qfi = FindQueueFamilies(physicalGPU);
 
-    transferContext->SetQueue(transferQueues[0]);
-    immediateContext->SetQueue(primaryGraphicsQueue);
+    createFrameRing();
 }
 
 void GraphicsDevice::cleanup()
 {
     WaitForGPUIdle();
 
+    if (!pipelineManifest->Save(PIPELINE_MANIFEST_PATH))
+        std::cout << "pipeline manifest: failed to save " << PIPELINE_MANIFEST_PATH << std::endl;
+    pipelineManifest->Destroy();
+
+    deletionQueue->Flush();
+    if (computeDeletionQueue != deletionQueue)
+        computeDeletionQueue->Flush();
+
     cleanupSwapchain();
 
-    vkDestroyDescriptorSetLayout(GPU, descriptorSetLayout, nullptr);
+    immediateContext->Destroy();
+    transferContext->Destroy();
+    computeContext->Destroy();
+
+    vkDestroyRenderPass(GPU, renderPass, nullptr);
+
+    destroyFrameRing();
+
+    samplerCache->Destroy();
+    imageViewCache->Destroy();
+
+    pipelineStateCache->Destroy();
+    descriptorAllocator->Destroy();
+    if (bindlessTable) bindlessTable->Destroy();
+    descriptorLayoutCache->Destroy(); //after the pipelines, states hand their layouts back through the deletion queue
+
+    if (!pipelineCache->Save(PIPELINE_CACHE_PATH))
+        std::cout << "pipeline cache: failed to save " << PIPELINE_CACHE_PATH << std::endl;
+    pipelineCache->Destroy();
+
+    for (GPUQueue* pQueue : getUniqueQueues())
+        pQueue->Destroy();
 
     vkDestroyDevice(GPU, nullptr);
 
@@ -55,11 +117,14 @@ void GraphicsDevice::cleanup()
         DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
     }
 
-    vkDestroySurfaceKHR(instance, surface, nullptr);
+    if (!headless) vkDestroySurfaceKHR(instance, surface, nullptr);
     vkDestroyInstance(instance, nullptr);
 
-    glfwDestroyWindow(pApplicationWindow);
-    glfwTerminate();
+    if (!headless)
+    {
+        glfwDestroyWindow(pApplicationWindow);
+        glfwTerminate();
+    }
 }
 
 void GraphicsDevice::cleanupSwapchain()
@@ -68,33 +133,12 @@ void GraphicsDevice::cleanupSwapchain()
         vkDestroyFramebuffer(GPU, swapChainFramebuffers[i], nullptr);
     }
 
-    vkDestroyFence(GPU, acquireImageFence, nullptr);
-
-    pShader->Destroy();
-
-    immediateContext->Destroy();
-    transferContext->Destroy();
-
-    for (int i = 0; i < inflightFrames.size(); i++)
-    {
-        vkDestroySemaphore(GPU, inflightFrames[i]->imageAvailable, nullptr);
-        vkDestroySemaphore(GPU, inflightFrames[i]->renderFinished, nullptr);
-
-        delete inflightFrames[i];
-        inflightFrames.erase(inflightFrames.begin() + i);
-    }
-
-    vkDestroyDescriptorPool(GPU, descriptorPool, nullptr);
-
-    vkDestroyPipeline(GPU, graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(GPU, pipelineLayout, nullptr);
-    vkDestroyRenderPass(GPU, renderPass, nullptr);
-
     for (size_t i = 0; i < swapChainImageViews.size(); i++) {
         vkDestroyImageView(GPU, swapChainImageViews[i], nullptr);
     }
 
-    vkDestroySwapchainKHR(GPU, swapChain, nullptr);
+    if (headless) destroyHeadlessTargets();
+    else vkDestroySwapchainKHR(GPU, swapChain, nullptr);
 }
 
 void GraphicsDevice::createInstance()
@@ -109,7 +153,7 @@ void GraphicsDevice::createInstance()
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "CatastrophicEngineVK";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_2; //timeline semaphores are core in 1.2
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -142,49 +186,87 @@ void GraphicsDevice::createLogicalDevice()
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 
-    std::vector<std::pair<uint32_t,uint32_t>> uniqueQueueFamilies = { 
-        std::pair<uint32_t,uint32_t>(indices.graphicsFamily.value(),indices.graphicsQueueCount),
-        std::pair<uint32_t,uint32_t>(indices.transferFamily.value(),indices.transferQueueCount),
-        std::pair<uint32_t,uint32_t>(indices.computeFamily.value(),indices.computeQueueCount) 
+    //one create info per family, fallback families alias the graphics family and must not be listed twice
+    std::map<uint32_t, uint32_t> familyQueueCounts;
+    auto requestQueues = [&](uint32_t family, uint32_t count)
+    {
+        uint32_t& queueCount = familyQueueCounts[family];
+        queueCount = std::max(queueCount, count);
     };
 
-    float queuePriority = 1.0f;
-    for(int i = 0; i < uniqueQueueFamilies.size(); i++)
+    requestQueues(indices.graphicsFamily.value(), 1); //only 1 graphics queue for performance reasons
+    requestQueues(indices.transferFamily.value(), indices.transferQueueCount); //all other families get as many queues as the gpu supports
+    requestQueues(indices.computeFamily.value(), indices.computeQueueCount);
+    if (indices.presentFamily.has_value()) requestQueues(indices.presentFamily.value(), 1);
+
+    std::vector<std::vector<float>> queuePriorities;
+    queuePriorities.reserve(familyQueueCounts.size());
+
+    for (auto& family : familyQueueCounts)
     {
-        auto queueFamily = uniqueQueueFamilies[i];
+        queuePriorities.emplace_back(family.second, 1.0f);
 
         VkDeviceQueueCreateInfo queueCreateInfo{};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo.queueFamilyIndex = family.first;
+        queueCreateInfo.queueCount = family.second;
+        queueCreateInfo.pQueuePriorities = queuePriorities.back().data();
 
-        queueCreateInfo.queueFamilyIndex = queueFamily.first;
+        queueCreateInfos.push_back(queueCreateInfo);
+    }
 
-        if (i != 0) //all other queues other than index 0 (graphics) will have as many queues as the gpu supports
-        {
-            queueCreateInfo.queueCount = queueFamily.second;
-            float* pQueuePriorities = new float[queueCreateInfo.queueCount];
+    VkPhysicalDeviceFeatures DeviceFeatures{};
 
-            for (int i = 0; i < queueCreateInfo.queueCount; i++) pQueuePriorities[i] = 1.0f;
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.timelineSemaphore = VK_TRUE;
+    void** ppNextFeature = &vulkan12Features.pNext; //optional feature structs chain on here
 
-            queueCreateInfo.pQueuePriorities = pQueuePriorities;
-        }
-        else
-        {
-            queueCreateInfo.queueCount = 1; //only 1 graphics queue for performance reasons
-            queueCreateInfo.pQueuePriorities = &queuePriority;
-        }
+    if (bindlessSupported) //core in 1.2, no extension to enable
+    {
+        vulkan12Features.descriptorIndexing = VK_TRUE;
+        vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+        vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        vulkan12Features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+    }
 
-        queueCreateInfos.push_back(queueCreateInfo);
+#ifdef VK_EXT_graphics_pipeline_library
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{};
+    pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    pipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+    if (pipelineLibrarySupported)
+    {
+        *ppNextFeature = &pipelineLibraryFeatures;
+        ppNextFeature = &pipelineLibraryFeatures.pNext;
     }
+#endif
+
+#ifdef VK_EXT_extended_dynamic_state
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+    extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+    if (extendedDynamicStateSupported)
+    {
+        *ppNextFeature = &extendedDynamicStateFeatures;
+        ppNextFeature = &extendedDynamicStateFeatures.pNext;
+    }
+#endif
 
-    VkPhysicalDeviceFeatures DeviceFeatures{};
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &vulkan12Features;
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pEnabledFeatures = &DeviceFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    auto extensions = getRequiredDeviceExtensions();
+    extensions.insert(extensions.end(), optionalDeviceExtensions.begin(), optionalDeviceExtensions.end());
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     if (enableValidationLayers)
     {
@@ -197,8 +279,10 @@ void GraphicsDevice::createLogicalDevice()
 
     VULKAN_CALL_ERROR(vkCreateDevice(physicalGPU, &createInfo, nullptr, &GPU), "failed to create logical device!");
 
+    loadExtendedDynamicState();
+
     vkGetDeviceQueue(GPU, indices.graphicsFamily.value(), 0, &primaryGraphicsQueue);
-    vkGetDeviceQueue(GPU, indices.presentFamily.value(), 0, &presentQueue);
+    if (!headless) vkGetDeviceQueue(GPU, indices.presentFamily.value(), 0, &presentQueue);
 
     //get transfer queues
 
@@ -217,14 +301,105 @@ void GraphicsDevice::createLogicalDevice()
         vkGetDeviceQueue(GPU, indices.computeFamily.value(), i, &computeQueue);
         computeQueues.push_back(computeQueue);
     }
+
+    createGPUQueues();
 }
 
-void GraphicsDevice::createSwapChain()
+void GraphicsDevice::createGPUQueues()
+{
+    QueueFamilyIndices indices = FindQueueFamilies(physicalGPU);
+
+    graphicsQueue = nullptr;
+    transferQueue = nullptr;
+    computeQueue = nullptr;
+    presentGPUQueue = nullptr;
+
+    //vkQueueSubmit needs the VkQueue externally synchronized, so every distinct VkQueue gets exactly one GPUQueue (one lock, one timeline)
+    auto getOrCreate = [&](VkQueue queue, uint32_t family)
+    {
+        for (auto& existing : { graphicsQueue, transferQueue, computeQueue })
+        {
+            if (existing && existing->GetQueue() == queue)
+                return existing;
+        }
+
+        auto gpuQueue = std::make_shared<GPUQueue>();
+        gpuQueue->Create(GPU, queue, family);
+        return gpuQueue;
+    };
+
+    graphicsQueue = getOrCreate(primaryGraphicsQueue, indices.graphicsFamily.value());
+    transferQueue = getOrCreate(transferQueues[0], indices.transferFamily.value());
+    computeQueue = getOrCreate(computeQueues[0], indices.computeFamily.value());
+
+    if (headless)
+        presentGPUQueue = graphicsQueue; //never presents
+    else
+        presentGPUQueue = getOrCreate(presentQueue, indices.presentFamily.value());
+}
+
+std::vector<GPUQueue*> GraphicsDevice::getUniqueQueues() const
+{
+    std::vector<GPUQueue*> queues;
+    for (auto& queue : { graphicsQueue, transferQueue, computeQueue, presentGPUQueue })
+    {
+        if (queue && std::find(queues.begin(), queues.end(), queue.get()) == queues.end())
+            queues.push_back(queue.get());
+    }
+    return queues;
+}
+
+void GraphicsDevice::createHeadlessTargets()
+{
+    swapChainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    swapChainExtent = headlessExtent;
+
+    //one target per ring slot, the frame's timeline wait is all the synchronization they need
+    swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+    headlessImageMemory.resize(MAX_FRAMES_IN_FLIGHT);
+
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = swapChainImageFormat;
+        imageInfo.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VULKAN_CALL_ERROR(vkCreateImage(GPU, &imageInfo, nullptr, &swapChainImages[i]), "failed to create headless render target");
+
+        VkMemoryRequirements memoryRequirements;
+        vkGetImageMemoryRequirements(GPU, swapChainImages[i], &memoryRequirements);
+
+        headlessImageMemory[i] = memoryManager->AllocateGPUMemory(memoryRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        VULKAN_CALL(vkBindImageMemory(GPU, swapChainImages[i], headlessImageMemory[i]->handle, 0));
+    }
+}
+
+void GraphicsDevice::destroyHeadlessTargets()
+{
+    for (size_t i = 0; i < swapChainImages.size(); i++)
+    {
+        vkDestroyImage(GPU, swapChainImages[i], nullptr);
+        memoryManager->ReleaseGPUMemory(headlessImageMemory[i]->allocID);
+    }
+    swapChainImages.clear();
+    headlessImageMemory.clear();
+}
+
+void GraphicsDevice::createSwapChain(VkSwapchainKHR oldSwapchain)
 {
     SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(physicalGPU);
 
     VkSurfaceFormatKHR surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = ChooseSwapPresentMode(swapChainSupport.presentModes);
+    presentMode = ChooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = ChooseSwapExtent(swapChainSupport.capabilities);
 
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -262,7 +437,7 @@ void GraphicsDevice::createSwapChain()
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    createInfo.oldSwapchain = oldSwapchain; //lets the driver hand over images without a gap
 
     VULKAN_CALL_ERROR(vkCreateSwapchainKHR(GPU, &createInfo, nullptr, &swapChain), "failed to create swapchain");
 
@@ -301,130 +476,6 @@ void GraphicsDevice::createImageViews()
     }
 }
 
-void GraphicsDevice::createGraphicsPipeline() //DEPRECATED DEMO CODE -- to be refactored
-{
-    pShader = new Shader(GPU);
-    pShader->LoadShader("shaders\\vs.spv", "main", VK_SHADER_STAGE_VERTEX_BIT);
-    pShader->LoadShader("shaders\\ps.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT);
-
-    VkPipelineShaderStageCreateInfo vertexStageInfo{};
-    vertexStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertexStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertexStageInfo.pName = pShader->GetShader(VK_SHADER_STAGE_VERTEX_BIT)->entrypoint;
-    vertexStageInfo.module = pShader->GetShader(VK_SHADER_STAGE_VERTEX_BIT)->module;
-
-    VkPipelineShaderStageCreateInfo pixelStageInfo{};
-    pixelStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    pixelStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    pixelStageInfo.pName = pShader->GetShader(VK_SHADER_STAGE_FRAGMENT_BIT)->entrypoint;
-    pixelStageInfo.module = pShader->GetShader(VK_SHADER_STAGE_FRAGMENT_BIT)->module;
-
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertexStageInfo, pixelStageInfo };
-
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-
-    auto bindingDesc = VertexPositionColor::GetBindingDescription();
-    auto attrDesc = VertexPositionColor::GetVertexAttributeDescriptions();
-
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attrDesc.size());
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDesc;
-    vertexInputInfo.pVertexAttributeDescriptions = attrDesc.data();
-
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-
-
-    //---
-    VkViewport viewport{};
-    viewport.x = 0;
-    viewport.y = 0;
-    viewport.width = (float)swapChainExtent.width;
-    viewport.height = (float)swapChainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0,0 };
-    scissor.extent = swapChainExtent;
-
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
-    viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
-
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-    rasterizer.lineWidth = 1.0f;
-
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_TRUE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f; // Optional
-    colorBlending.blendConstants[1] = 0.0f; // Optional
-    colorBlending.blendConstants[2] = 0.0f; // Optional
-    colorBlending.blendConstants[3] = 0.0f; // Optional
-
-    //VkPushConstantRange pcr_vertex_transforms{}; //todo: implement push constant management system
-    //pcr_vertex_transforms.offset = 0;
-    //pcr_vertex_transforms.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    //pcr_vertex_transforms.size = sizeof(glm::mat4) * 3;
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-
-    VULKAN_CALL_ERROR(vkCreatePipelineLayout(GPU, &pipelineLayoutInfo, nullptr, &pipelineLayout), "Failed to create pipeline layout!");
-
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
-
-    VULKAN_CALL_ERROR(vkCreateGraphicsPipelines(GPU, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline), "Failed to create graphics pipeline!");
-}
-
 void GraphicsDevice::createRenderPass()
 {
     VkAttachmentDescription colorAttachment{};
@@ -435,7 +486,7 @@ void GraphicsDevice::createRenderPass()
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; //headless frames are read back, not presented
 
     VkAttachmentReference colorAttachmentRef{};
 
@@ -496,9 +547,17 @@ void GraphicsDevice::createCommandPools()
 
     transferContext = std::make_shared<DeviceContext>();
     immediateContext = std::make_shared<DeviceContext>();
+    computeContext = std::make_shared<DeviceContext>();
 
-    immediateContext->Create(GPU, queueFamilyIndices.graphicsFamily.value());
-    transferContext->Create(GPU, queueFamilyIndices.transferFamily.value());
+    immediateContext->Create(GPU, queueFamilyIndices.graphicsFamily.value(), false, MAX_FRAMES_IN_FLIGHT);
+    transferContext->Create(GPU, queueFamilyIndices.transferFamily.value(), false, MAX_FRAMES_IN_FLIGHT);
+    computeContext->Create(GPU, queueFamilyIndices.computeFamily.value(), false, MAX_FRAMES_IN_FLIGHT);
+
+    immediateContext->SetQueue(graphicsQueue.get());
+    transferContext->SetQueue(transferQueue.get());
+    computeContext->SetQueue(computeQueue.get());
+
+    immediateContext->SetExtendedDynamicState(extendedDynamicStateSupported ? &extendedDynamicState : nullptr);
 
     ImmediateContext = immediateContext;
     TransferContext = transferContext;
@@ -506,6 +565,9 @@ void GraphicsDevice::createCommandPools()
 
 void GraphicsDevice::recreateSwapChain()
 {
+    if (headless)
+        return; //fixed size targets
+
     int width = 0, height = 0;
     glfwGetFramebufferSize(pApplicationWindow, &width, &height);
     while (width == 0 || height == 0) {
@@ -513,55 +575,88 @@ void GraphicsDevice::recreateSwapChain()
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(GPU);
+    framebufferResized = false;
+    presentModeChanged = false;
 
-    cleanupSwapchain();
-    createSwapChain();
+    //size dependent objects retire once the last frame that used them has finished, nothing waits for idle
+    VkSwapchainKHR oldSwapchain = swapChain;
+    std::vector<VkFramebuffer> oldFramebuffers = swapChainFramebuffers;
+    std::vector<VkImageView> oldImageViews = swapChainImageViews;
+    VkDevice gpu = GPU;
+
+    deletionQueue->Enqueue([gpu, oldSwapchain, oldFramebuffers, oldImageViews]()
+    {
+        for (VkFramebuffer framebuffer : oldFramebuffers)
+            vkDestroyFramebuffer(gpu, framebuffer, nullptr);
+        for (VkImageView view : oldImageViews)
+            vkDestroyImageView(gpu, view, nullptr);
+        vkDestroySwapchainKHR(gpu, oldSwapchain, nullptr);
+    });
+
+    VkFormat oldFormat = swapChainImageFormat;
+
+    createSwapChain(oldSwapchain);
     createImageViews();
-    createRenderPass();
-    createGraphicsPipeline();
-    createFramebuffers();
 
-    createCommandPools(); //7-8-2020 to fix window min/maximization bug
-    createDescriptorPool();
-    //todo: fire some kind of event so that the "user" code can re-create any gpu resources.
+    if (swapChainImageFormat != oldFormat) //practically never, but pipelines built against the old pass would need rebuilding
+    {
+        VkRenderPass oldRenderPass = renderPass;
+        deletionQueue->Enqueue([gpu, oldRenderPass]() { vkDestroyRenderPass(gpu, oldRenderPass, nullptr); });
+        createRenderPass();
+    }
 
-    PrepareFrame();
+    createFramebuffers();
+
+    //pipelines, contexts, descriptor pools and user resources stay valid, viewport and scissor are dynamic state
 }
 
 void GraphicsDevice::DrawFrame()
 {
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    std::vector<SemaphoreWait> waits = frameWaits;
+    std::vector<VkSemaphore> binarySignals;
+    frameWaits.clear();
 
-    VkSemaphore waitSemaphores[] = { pActiveFrame->imageAvailable };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &pActiveFrame->cmdBuffer->handle;
-    VkSemaphore signalSemaphores[] = { pActiveFrame->renderFinished };
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    if (!headless)
+    {
+        waits.push_back({ pActiveFrame->imageAvailable, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT });
+        binarySignals.push_back(pActiveFrame->renderFinished);
+    }
+
+    //graphics work may wait on transfer/compute timeline values, get those to the driver first
+    transferQueue->Flush();
+    computeQueue->Flush();
 
-    vkResetFences(GPU, 1, &pActiveFrame->cmdBuffer->fence);
-    vkQueueSubmit(primaryGraphicsQueue, 1, &submitInfo, pActiveFrame->cmdBuffer->fence);
+    pActiveFrame->timelineValue = graphicsQueue->Submit(1, &pActiveFrame->cmdBuffer->handle, waits, binarySignals);
 
-    VkPresentInfoKHR presentInfo{};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    if (headless)
+    {
+        graphicsQueue->Flush(); //nothing to present, this is the frame's sync point
+    }
+    else
+    {
+        VkPresentInfoKHR presentInfo{};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = &pActiveFrame->renderFinished;
 
-    VkSwapchainKHR swapChains[] = { swapChain };
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapChains;
-    presentInfo.pImageIndices = &imageIndex; //possible issue 6-16
+        VkSwapchainKHR swapChains[] = { swapChain };
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = swapChains;
+        presentInfo.pImageIndices = &imageIndex; //possible issue 6-16
 
-    presentInfo.pResults = nullptr; // Optional
+        presentInfo.pResults = nullptr; // Optional
 
-    vkQueuePresentKHR(presentQueue, &presentInfo);
+        VkResult res = presentGPUQueue->Present(presentInfo); //flushes the frame's graphics batch
+        graphicsQueue->Flush(); //no-op unless present lives on its own queue
+
+        if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR || framebufferResized || presentModeChanged)
+            recreateSwapChain();
+        else if (res != VK_SUCCESS)
+            throw std::runtime_error("failed to present swap chain image");
+    }
+
+    presentation->OnPresent();
 
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
@@ -587,11 +682,16 @@ void GraphicsDevice::setupDebugMessenger()
 
 std::vector<const char*> GraphicsDevice::getRequiredExtensions()
 {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char*> extensions;
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    if (!headless) //surface extensions only, headless needs nothing beyond core
+    {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -600,9 +700,22 @@ std::vector<const char*> GraphicsDevice::getRequiredExtensions()
     return extensions;
 }
 
-void GraphicsDevice::SetPushConstants(VkShaderStageFlags stage, size_t size, const void* pConstantData)
+void GraphicsDevice::SetPushConstants(VkShaderStageFlags stage, size_t size, const void* pConstantData, uint32_t offset)
+{
+    if (!pBoundPipelineState)
+        return; //draw is being skipped while its pipeline compiles
+
+    immediateContext->PushConstants(GetCurrentFrame()->cmdBuffer, pBoundPipelineState->GetPipelineLayout(), stage, offset, static_cast<uint32_t>(size), pConstantData);
+}
+
+FrameAllocation GraphicsDevice::AllocateFrameMemory(VkDeviceSize size, VkDeviceSize alignment)
 {
-    vkCmdPushConstants(GetCurrentFrame()->cmdBuffer->handle, pipelineLayout, stage, 0, size, pConstantData);
+    return pActiveFrame->pAllocator->Allocate(size, alignment);
+}
+
+VkDescriptorSet GraphicsDevice::AllocateFrameDescriptorSet(VkDescriptorSetLayout layout)
+{
+    return pActiveFrame->pDescriptors->Allocate(layout);
 }
 
 InflightFrame* GraphicsDevice::GetCurrentFrame()
@@ -641,66 +754,6 @@ void GraphicsDevice::CreateSurface() //possible weird shit
     VULKAN_CALL_ERROR(glfwCreateWindowSurface(instance, pApplicationWindow, nullptr, &surface), "error creating window surface");
 }
 
-void GraphicsDevice::createDescriptorPool() //deprecated
-{
-    VkDescriptorPoolSize cbPoolSize{};
-    cbPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    cbPoolSize.descriptorCount = 16;
-
-    VkDescriptorPoolSize samplerPoolSize{};
-    samplerPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerPoolSize.descriptorCount = 4;
-
-    std::array<VkDescriptorPoolSize, 2> poolSizes = { cbPoolSize, samplerPoolSize };
-
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = poolSizes.size();
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(swapChainImages.size());
-
-    VULKAN_CALL_ERROR(vkCreateDescriptorPool(GPU, &poolInfo, nullptr, &descriptorPool), "failed to create descriptor pool");
-}
-
-void GraphicsDevice::createDescriptorSetLayout() //deprecated
-{
-    VkDescriptorSetLayoutBinding uboLayoutBinding{};
-    uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    uboLayoutBinding.pImmutableSamplers = nullptr;
-
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = 1;
-    layoutInfo.pBindings = &uboLayoutBinding;
-
-    VULKAN_CALL_ERROR(vkCreateDescriptorSetLayout(GPU, &layoutInfo, nullptr, &descriptorSetLayout), "Error creating descriptor set layout");
-}
-
-void GraphicsDevice::createDescriptorSets() //deprecated
-{
-    //TODO: go through registered descriptors and
-    //TODO: eventially review nvidia presentation and move descriptor pool into device context
-
-    uint32_t numDescriptorSets = registeredDescriptors.size() * swapChainImages.size();
-
-    std::vector<VkDescriptorSetLayout> layouts(numDescriptorSets, descriptorSetLayout);
-
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());
-    allocInfo.pSetLayouts = layouts.data();
-
-    descriptorSets.resize(swapChainImages.size());
-
-    VULKAN_CALL(vkAllocateDescriptorSets(GPU, &allocInfo, descriptorSets.data()));
-
-    //TODO: interface portion after this with "user" code
-}
-
 void GraphicsDevice::RegisterShaderDescriptor(ShaderDescriptor* pDescriptor) //deprecated
 {
     registeredDescriptors.push_back(pDescriptor);
@@ -732,9 +785,14 @@ VkRenderPass GraphicsDevice::GetRenderPass() const
     return renderPass;
 }
 
-VkDescriptorPool GraphicsDevice::GetDescriptorPool() const
+std::shared_ptr<DescriptorAllocator> GraphicsDevice::GetDescriptorAllocator() const
+{
+    return descriptorAllocator;
+}
+
+std::shared_ptr<BindlessResourceTable> GraphicsDevice::GetBindlessResourceTable() const
 {
-    return descriptorPool;
+    return bindlessTable;
 }
 
 PipelineState* GraphicsDevice::GetPipelineState() const
@@ -742,6 +800,11 @@ PipelineState* GraphicsDevice::GetPipelineState() const
     return pPipelineState;
 }
 
+PipelineState* GraphicsDevice::GetBoundPipelineState() const
+{
+    return pBoundPipelineState;
+}
+
 
 
 VKAPI_ATTR VkBool32 VKAPI_CALL GraphicsDevice::debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData)
@@ -776,24 +839,116 @@ VkPhysicalDeviceProperties GraphicsDevice::GetDeviceProperties() const
     return gpuProperties;
 }
 
+bool GraphicsDevice::SupportsPipelineLibrary() const
+{
+    return pipelineLibrarySupported;
+}
+
+bool GraphicsDevice::SupportsExtendedDynamicState() const
+{
+    return extendedDynamicStateSupported;
+}
+
+bool GraphicsDevice::SupportsBindless() const
+{
+    return bindlessSupported;
+}
+
+bool GraphicsDevice::IsHeadless() const
+{
+    return headless;
+}
+
+VkImage GraphicsDevice::GetBackbufferImage() const
+{
+    return swapChainImages[imageIndex];
+}
+
+VkFormat GraphicsDevice::GetBackbufferFormat() const
+{
+    return swapChainImageFormat;
+}
+
 void GraphicsDevice::ResizeFramebuffer()
 {
     framebufferResized = true;
 }
 
+void GraphicsDevice::SetPresentMode(VkPresentModeKHR mode)
+{
+    if (mode == preferredPresentMode)
+        return;
+
+    preferredPresentMode = mode;
+    presentModeChanged = !headless; //swapchain is rebuilt after the next present
+}
+
+VkPresentModeKHR GraphicsDevice::GetPresentMode() const
+{
+    return presentMode;
+}
+
+std::vector<VkPresentModeKHR> GraphicsDevice::GetSupportedPresentModes()
+{
+    if (headless)
+        return {};
+
+    return QuerySwapChainSupport(physicalGPU).presentModes;
+}
+
+std::shared_ptr<PresentationController> GraphicsDevice::GetPresentationController() const
+{
+    return presentation;
+}
+
 int GraphicsDevice::PrepareFrame()
 {
+    lastFrameSubmitStats = {};
+    for (GPUQueue* pQueue : getUniqueQueues())
+    {
+        QueueSubmitStats stats = pQueue->GetFrameStats();
+        lastFrameSubmitStats.batches += stats.batches;
+        lastFrameSubmitStats.queueSubmitCalls += stats.queueSubmitCalls;
+        pQueue->ResetFrameStats();
+    }
+
+    //the previous frame is submitted, whatever was released while recording it retires with it
+    deletionQueue->Seal();
+    deletionQueue->Collect();
+    if (computeDeletionQueue != deletionQueue)
+    {
+        computeDeletionQueue->Seal();
+        computeDeletionQueue->Collect();
+    }
+
+    //recycles the command arenas of the frame that last used this slot
+    immediateContext->AdvanceFrame();
+    transferContext->AdvanceFrame();
+    computeContext->AdvanceFrame();
+
     pActiveFrame = GetAvailableFrame();
+    pActiveFrame->cmdBuffer = immediateContext->GetCommandBuffer();
+
+    if (headless)
+    {
+        imageIndex = static_cast<uint32_t>(currentFrame); //targets are per ring slot, no acquire
+        pActiveFrame->frameIndex = imageIndex;
+        return imageIndex;
+    }
+
     VkResult res = vkAcquireNextImageKHR(GPU, swapChain, UINT64_MAX, pActiveFrame->imageAvailable, VK_NULL_HANDLE, &imageIndex);
-    pActiveFrame->frameIndex = imageIndex;
 
     if (res == VK_ERROR_OUT_OF_DATE_KHR)
     {
+        //a failed acquire leaves the semaphore unsignalled, so it can be reused right away
         recreateSwapChain();
+        res = vkAcquireNextImageKHR(GPU, swapChain, UINT64_MAX, pActiveFrame->imageAvailable, VK_NULL_HANDLE, &imageIndex);
     }
-    else if (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR)
+
+    if (res != VK_SUCCESS && res != VK_SUBOPTIMAL_KHR)
         throw std::runtime_error("Failed to acquire swap chain image!");
 
+    pActiveFrame->frameIndex = imageIndex;
     return imageIndex;
 }
 
@@ -802,15 +957,82 @@ std::shared_ptr<GPUMemoryManager> GraphicsDevice::GetMainGPUMemoryAllocator() co
     return memoryManager;
 }
 
-void GraphicsDevice::PrimaryGraphicsQueueSubmit(VkSubmitInfo submitInfo, bool block)
+std::shared_ptr<ImageViewCache> GraphicsDevice::GetImageViewCache() const
+{
+    return imageViewCache;
+}
+
+std::shared_ptr<SamplerCache> GraphicsDevice::GetSamplerCache() const
+{
+    return samplerCache;
+}
+
+std::shared_ptr<DeferredDeletionQueue> GraphicsDevice::GetDeletionQueue(VkQueueFlagBits queueType) const
+{
+    return queueType == VK_QUEUE_COMPUTE_BIT ? computeDeletionQueue : deletionQueue;
+}
+
+std::shared_ptr<PipelineCache> GraphicsDevice::GetPipelineCache() const
+{
+    return pipelineCache;
+}
+
+std::shared_ptr<PipelineStateCache> GraphicsDevice::GetPipelineStateCache() const
+{
+    return pipelineStateCache;
+}
+
+std::shared_ptr<DescriptorLayoutCache> GraphicsDevice::GetDescriptorLayoutCache() const
+{
+    return descriptorLayoutCache;
+}
+
+std::shared_ptr<PipelineManifest> GraphicsDevice::GetPipelineManifest() const
+{
+    return pipelineManifest;
+}
+
+uint64_t GraphicsDevice::PrimaryGraphicsQueueSubmit(VkSubmitInfo submitInfo, bool block)
+{
+    uint64_t value = graphicsQueue->Submit(submitInfo);
+    if (block) graphicsQueue->Wait(value);
+    return value;
+}
+
+uint64_t GraphicsDevice::PrimaryTransferQueueSubmit(uint32_t transferQueueIndex, VkSubmitInfo submitInfo, bool block)
+{
+    //only queue 0 of the transfer family has a timeline, the rest are unused so far
+    if (transferQueueIndex != 0)
+        throw std::runtime_error("only transfer queue 0 is available for submission");
+
+    uint64_t value = transferQueue->Submit(submitInfo);
+    if (block) transferQueue->Wait(value);
+    return value;
+}
+
+void GraphicsDevice::FlushQueues()
 {
-    vkQueueSubmit(primaryGraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    if (block) vkQueueWaitIdle(primaryGraphicsQueue);
+    for (GPUQueue* pQueue : getUniqueQueues())
+        pQueue->Flush();
 }
 
-void GraphicsDevice::PrimaryTransferQueueSubmit(uint32_t transferQueueIndex, VkSubmitInfo submitInfo, bool block)
+QueueSubmitStats GraphicsDevice::GetLastFrameSubmitStats() const
 {
-    VULKAN_CALL_ERROR(vkQueueSubmit(transferQueues[transferQueueIndex], 1, &submitInfo, VK_NULL_HANDLE), "failed to submit transfer queue");
+    return lastFrameSubmitStats;
+}
+
+GPUQueue* GraphicsDevice::GetGPUQueue(VkQueueFlagBits queueType) const
+{
+    switch (queueType)
+    {
+        case VK_QUEUE_TRANSFER_BIT:
+            return transferQueue.get();
+        case VK_QUEUE_COMPUTE_BIT:
+            return computeQueue.get();
+        case VK_QUEUE_GRAPHICS_BIT:
+        default:
+            return graphicsQueue.get();
+    }
 }
 
 VkQueue GraphicsDevice::GetTransferQueue(uint32_t index)
@@ -828,6 +1050,16 @@ std::shared_ptr<DeviceContext> GraphicsDevice::GetTransferContext() const
     return transferContext;
 }
 
+std::shared_ptr<DeviceContext> GraphicsDevice::GetComputeContext() const
+{
+    return computeContext;
+}
+
+void GraphicsDevice::AddFrameWait(const SemaphoreWait& wait)
+{
+    frameWaits.push_back(wait);
+}
+
 std::shared_ptr<DeviceContext> GraphicsDevice::CreateDeviceContext(VkQueueFlagBits queueType, bool transient)
 {
     auto deviceContext = std::make_shared<DeviceContext>();
@@ -853,11 +1085,14 @@ std::shared_ptr<DeviceContext> GraphicsDevice::CreateDeviceContext(VkQueueFlagBi
         }
     }
 
-    deviceContext->Create(GPU, queueFamily, transient);
+    deviceContext->Create(GPU, queueFamily, transient, MAX_FRAMES_IN_FLIGHT);
+    if (queueType == VK_QUEUE_GRAPHICS_BIT)
+        deviceContext->SetExtendedDynamicState(extendedDynamicStateSupported ? &extendedDynamicState : nullptr);
+    deviceContext->SetQueue(GetGPUQueue(queueType));
     return deviceContext;
 }
 
-void GraphicsDevice::BeginRenderPass()
+void GraphicsDevice::BeginRenderPass(VkSubpassContents contents)
 {
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -865,6 +1100,7 @@ void GraphicsDevice::BeginRenderPass()
     beginInfo.pInheritanceInfo = nullptr; // Optional
 
     VULKAN_CALL(vkBeginCommandBuffer(pActiveFrame->cmdBuffer->handle, &beginInfo));
+    pActiveFrame->cmdBuffer->ResetPushConstants();
 
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -877,9 +1113,36 @@ void GraphicsDevice::BeginRenderPass()
     renderPassInfo.clearValueCount = 1;
     renderPassInfo.pClearValues = &clearColor;
 
-    vkCmdBeginRenderPass(pActiveFrame->cmdBuffer->handle, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(pActiveFrame->cmdBuffer->handle, &renderPassInfo, contents);
 
-    vkCmdBindPipeline(pActiveFrame->cmdBuffer->handle, VK_PIPELINE_BIND_POINT_GRAPHICS, pPipelineState->GetPipeline());
+    if (contents == VK_SUBPASS_CONTENTS_INLINE) //secondaries set their own
+    {
+        VkViewport viewport = { 0.0f, 0.0f, (float)swapChainExtent.width, (float)swapChainExtent.height, 0.0f, 1.0f };
+        VkRect2D scissor = { { 0, 0 }, swapChainExtent };
+        vkCmdSetViewport(pActiveFrame->cmdBuffer->handle, 0, 1, &viewport);
+        vkCmdSetScissor(pActiveFrame->cmdBuffer->handle, 0, 1, &scissor);
+    }
+
+    pBoundPipelineState = nullptr;
+    if (contents == VK_SUBPASS_CONTENTS_INLINE && pPipelineState) //only vkCmdExecuteCommands is allowed otherwise, state doesn't carry into secondaries anyway
+    {
+        pBoundPipelineState = pPipelineState->Resolve(); //still compiling without a fallback: nothing bound, caller skips its draws
+        if (pBoundPipelineState)
+        {
+            vkCmdBindPipeline(pActiveFrame->cmdBuffer->handle, VK_PIPELINE_BIND_POINT_GRAPHICS, pBoundPipelineState->GetPipeline());
+            pActiveFrame->cmdBuffer->ResetPushConstants();
+        }
+    }
+}
+
+VkCommandBufferInheritanceInfo GraphicsDevice::GetRenderPassInheritance() const
+{
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = renderPass;
+    inheritance.subpass = 0;
+    inheritance.framebuffer = swapChainFramebuffers[imageIndex];
+    return inheritance;
 }
 
 void GraphicsDevice::EndRenderPass()
@@ -890,6 +1153,7 @@ void GraphicsDevice::EndRenderPass()
 
 void GraphicsDevice::WaitForGPUIdle()
 {
+    FlushQueues();
     vkDeviceWaitIdle(GPU);
 }
 
@@ -909,14 +1173,20 @@ QueueFamilyIndices GraphicsDevice::FindQueueFamilies(VkPhysicalDevice physicalGP
 
         if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
         {
-            indices.graphicsFamily = i;
-            indices.graphicsQueueCount = queueFamilies[i].queueCount;
+            if (!indices.graphicsFamily.has_value())
+            {
+                indices.graphicsFamily = i;
+                indices.graphicsQueueCount = queueFamilies[i].queueCount;
+            }
 
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(physicalGPU, i, surface, &presentSupport);
+            if (surface != VK_NULL_HANDLE)
+            {
+                VkBool32 presentSupport = false;
+                vkGetPhysicalDeviceSurfaceSupportKHR(physicalGPU, i, surface, &presentSupport);
 
-            if (presentSupport) {
-                indices.presentFamily = i;
+                if (presentSupport) {
+                    indices.presentFamily = i;
+                }
             }
         }
 
@@ -932,11 +1202,26 @@ QueueFamilyIndices GraphicsDevice::FindQueueFamilies(VkPhysicalDevice physicalGP
             indices.computeQueueCount = queueFamilies[i].queueCount;
         }
 
-        if (indices.isComplete()) {
+        if (indices.isComplete(surface != VK_NULL_HANDLE)) {
             break;
         }
     }
 
+    //integrated gpus and software rasterizers often expose a single family, share it instead of failing
+    if (indices.graphicsFamily.has_value())
+    {
+        if (!indices.computeFamily.has_value())
+        {
+            indices.computeFamily = indices.graphicsFamily;
+            indices.computeQueueCount = 1;
+        }
+        if (!indices.transferFamily.has_value()) //compute families can always transfer
+        {
+            indices.transferFamily = indices.computeFamily;
+            indices.transferQueueCount = 1;
+        }
+    }
+
     return indices;
 }
 
@@ -946,13 +1231,30 @@ bool GraphicsDevice::IsDeviceSuitable(VkPhysicalDevice physicalGPU)
 
     bool extensionsSupported = CheckDeviceExtensionSupport(physicalGPU);
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
+    bool swapChainAdequate = headless;
+    if (extensionsSupported && !headless) {
         SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(physicalGPU);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalGPU, &properties);
+
+    bool timelineSemaphoresSupported = false;
+    if (properties.apiVersion >= VK_API_VERSION_1_2)
+    {
+        VkPhysicalDeviceVulkan12Features vulkan12Features{};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &vulkan12Features;
+        vkGetPhysicalDeviceFeatures2(physicalGPU, &features);
+
+        timelineSemaphoresSupported = vulkan12Features.timelineSemaphore == VK_TRUE;
+    }
+
+    return indices.isComplete(!headless) && extensionsSupported && swapChainAdequate && timelineSemaphoresSupported;
 }
 
 bool GraphicsDevice::CheckDeviceExtensionSupport(VkPhysicalDevice physicalGPU)
@@ -963,6 +1265,7 @@ bool GraphicsDevice::CheckDeviceExtensionSupport(VkPhysicalDevice physicalGPU)
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(physicalGPU, nullptr, &extensionCount, availableExtensions.data());
 
+    auto deviceExtensions = getRequiredDeviceExtensions();
     std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
 
     for (const auto& extension : availableExtensions) {
@@ -972,6 +1275,115 @@ bool GraphicsDevice::CheckDeviceExtensionSupport(VkPhysicalDevice physicalGPU)
     return requiredExtensions.empty();
 }
 
+std::vector<const char*> GraphicsDevice::getRequiredDeviceExtensions() const
+{
+    if (headless)
+        return {}; //swapchain is the only extension we need so far
+
+    return deviceExtensions;
+}
+
+void GraphicsDevice::queryOptionalFeatures()
+{
+    optionalDeviceExtensions.clear();
+    pipelineLibrarySupported = false;
+    extendedDynamicStateSupported = false;
+    bindlessSupported = false;
+
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalGPU, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalGPU, nullptr, &extensionCount, availableExtensions.data());
+
+    std::set<std::string> available;
+    for (const auto& extension : availableExtensions)
+        available.insert(extension.extensionName);
+
+#ifdef VK_EXT_graphics_pipeline_library
+    if (available.count(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) && available.count(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+    {
+        VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{};
+        pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &pipelineLibraryFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalGPU, &features);
+
+        if (pipelineLibraryFeatures.graphicsPipelineLibrary == VK_TRUE)
+        {
+            pipelineLibrarySupported = true;
+            optionalDeviceExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+            optionalDeviceExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+        }
+    }
+#endif
+
+#ifdef VK_EXT_extended_dynamic_state
+    if (available.count(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME))
+    {
+        VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+        extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &extendedDynamicStateFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalGPU, &features);
+
+        if (extendedDynamicStateFeatures.extendedDynamicState == VK_TRUE)
+        {
+            extendedDynamicStateSupported = true;
+            optionalDeviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+        }
+    }
+#endif
+
+    {
+        VkPhysicalDeviceVulkan12Features vulkan12Features{};
+        vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &vulkan12Features;
+        vkGetPhysicalDeviceFeatures2(physicalGPU, &features);
+
+        bindlessSupported = vulkan12Features.descriptorIndexing && vulkan12Features.runtimeDescriptorArray
+            && vulkan12Features.descriptorBindingPartiallyBound && vulkan12Features.descriptorBindingUpdateUnusedWhilePending
+            && vulkan12Features.descriptorBindingSampledImageUpdateAfterBind && vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind
+            && vulkan12Features.shaderSampledImageArrayNonUniformIndexing && vulkan12Features.shaderStorageBufferArrayNonUniformIndexing;
+
+        descriptorIndexingProperties = {};
+        descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &descriptorIndexingProperties;
+        vkGetPhysicalDeviceProperties2(physicalGPU, &properties);
+    }
+
+    std::cout << "bindless descriptors: " << (bindlessSupported ? "enabled" : "unavailable") << std::endl;
+    std::cout << "extended dynamic state: " << (extendedDynamicStateSupported ? "enabled" : "unavailable") << std::endl;
+    std::cout << "graphics pipeline library: " << (pipelineLibrarySupported ? "enabled" : "unavailable, monolithic pipeline builds") << std::endl;
+}
+
+void GraphicsDevice::loadExtendedDynamicState()
+{
+#ifdef VK_EXT_extended_dynamic_state
+    if (!extendedDynamicStateSupported)
+        return;
+
+    extendedDynamicState.vkCmdSetCullMode = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(GPU, "vkCmdSetCullModeEXT");
+    extendedDynamicState.vkCmdSetFrontFace = (PFN_vkCmdSetFrontFaceEXT)vkGetDeviceProcAddr(GPU, "vkCmdSetFrontFaceEXT");
+    extendedDynamicState.vkCmdSetPrimitiveTopology = (PFN_vkCmdSetPrimitiveTopologyEXT)vkGetDeviceProcAddr(GPU, "vkCmdSetPrimitiveTopologyEXT");
+    extendedDynamicState.vkCmdSetDepthTestEnable = (PFN_vkCmdSetDepthTestEnableEXT)vkGetDeviceProcAddr(GPU, "vkCmdSetDepthTestEnableEXT");
+    extendedDynamicState.vkCmdSetDepthWriteEnable = (PFN_vkCmdSetDepthWriteEnableEXT)vkGetDeviceProcAddr(GPU, "vkCmdSetDepthWriteEnableEXT");
+    extendedDynamicState.vkCmdSetDepthCompareOp = (PFN_vkCmdSetDepthCompareOpEXT)vkGetDeviceProcAddr(GPU, "vkCmdSetDepthCompareOpEXT");
+
+    if (!extendedDynamicState.vkCmdSetCullMode || !extendedDynamicState.vkCmdSetDepthCompareOp)
+        extendedDynamicStateSupported = false; //enabled but not exported, stay on baked state
+#endif
+}
+
 void GraphicsDevice::PickPhysicalGPU()
 {
     uint32_t deviceCount = 0;
@@ -1055,27 +1467,15 @@ VkExtent2D GraphicsDevice::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capa
 
 InflightFrame* GraphicsDevice::GetAvailableFrame()
 {
-    if (inflightFrames.size() == 0)
-    {
-        InflightFrame* NewFrame = CreateInflightFrame();
-        inflightFrames.push_back(NewFrame);
-        return NewFrame;
-    }
-    else
-    {
-        for (int i = 0; i < inflightFrames.size(); i++)
-        {
-            VkResult status = vkGetFenceStatus(GPU, inflightFrames[i]->cmdBuffer->fence);
-            if (status == VK_SUCCESS) //this command buffer is done executing on the GPU, ready for reuse
-            {
-                return inflightFrames[i];
-            }
-        }
-        //no command buffers are available
-        InflightFrame* NewFrame = CreateInflightFrame();
-        inflightFrames.push_back(NewFrame);
-        return NewFrame;
-    }
+    InflightFrame* frame = inflightFrames[currentFrame];
+
+    //only blocks when the cpu is a full ring ahead of the gpu
+    graphicsQueue->Wait(frame->timelineValue);
+
+    frame->pAllocator->Reset();
+    frame->pDescriptors->Reset();
+
+    return frame;
 }
 
 InflightFrame* GraphicsDevice::CreateInflightFrame()
@@ -1088,16 +1488,90 @@ InflightFrame* GraphicsDevice::CreateInflightFrame()
     VULKAN_CALL(vkCreateSemaphore(GPU, &semaphore, nullptr, &frame->imageAvailable));
     VULKAN_CALL(vkCreateSemaphore(GPU, &semaphore, nullptr, &frame->renderFinished));
 
-    frame->cmdBuffer = ImmediateContext->GetCommandBuffer();
+    frame->timelineValue = 0;
+    frame->cmdBuffer = nullptr;
+    frame->frameIndex = 0;
+    frame->pPerFrameData = nullptr;
+
+    VkDeviceSize alignment = std::max(gpuProperties.limits.minUniformBufferOffsetAlignment, gpuProperties.limits.minStorageBufferOffsetAlignment);
+
+    frame->pAllocator = new FrameAllocator(this);
+    frame->pAllocator->Create(FRAME_ALLOCATOR_SIZE,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        alignment);
+
+    frame->pDescriptors = new DescriptorAllocator(GPU, FRAME_DESCRIPTOR_SETS, DescriptorAllocator::DefaultRatios());
 
     return frame;
 }
 
+void GraphicsDevice::createFrameRing()
+{
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+        inflightFrames.push_back(CreateInflightFrame());
+}
+
+void GraphicsDevice::destroyFrameRing()
+{
+    for (InflightFrame* frame : inflightFrames)
+    {
+        vkDestroySemaphore(GPU, frame->imageAvailable, nullptr);
+        vkDestroySemaphore(GPU, frame->renderFinished, nullptr);
+        frame->pDescriptors->Destroy();
+        delete frame->pDescriptors;
+
+        frame->pAllocator->Destroy();
+        delete frame->pAllocator;
+
+        delete frame;
+    }
+    inflightFrames.clear();
+}
+
 void GraphicsDevice::initializeMainMemoryManager()
 {
     memoryManager = std::make_shared<GPUMemoryManager>(physicalGPU, GPU);
 }
 
+void GraphicsDevice::createObjectCaches()
+{
+    imageViewCache = std::make_shared<ImageViewCache>(GPU);
+    samplerCache = std::make_shared<SamplerCache>(GPU, gpuProperties.limits.maxSamplerAllocationCount);
+    deletionQueue = std::make_shared<DeferredDeletionQueue>(graphicsQueue.get());
+    computeDeletionQueue = computeQueue == graphicsQueue ? deletionQueue : std::make_shared<DeferredDeletionQueue>(computeQueue.get());
+
+    pipelineCache = std::make_shared<PipelineCache>(GPU, gpuProperties);
+    pipelineCache->Load(PIPELINE_CACHE_PATH);
+    pipelineStateCache = std::make_shared<PipelineStateCache>(GPU, pipelineCache->GetCache());
+    descriptorLayoutCache = std::make_shared<DescriptorLayoutCache>(GPU);
+    descriptorAllocator = std::make_shared<DescriptorAllocator>(GPU, PERSISTENT_DESCRIPTOR_SETS, DescriptorAllocator::DefaultRatios(), VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+
+    if (bindlessSupported)
+    {
+        const auto& limits = descriptorIndexingProperties;
+        uint32_t maxImages = std::min({ BINDLESS_MAX_IMAGES, limits.maxPerStageDescriptorUpdateAfterBindSampledImages, limits.maxDescriptorSetUpdateAfterBindSampledImages });
+        uint32_t maxSamplers = std::min({ BINDLESS_MAX_SAMPLERS, limits.maxPerStageDescriptorUpdateAfterBindSamplers, limits.maxDescriptorSetUpdateAfterBindSamplers });
+        uint32_t maxBuffers = std::min({ BINDLESS_MAX_STORAGE_BUFFERS, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers });
+
+        //the per type limits can each be met while the sum still exceeds the per stage and pool wide totals, scale all three down evenly
+        uint32_t perStageBudget = limits.maxPerStageUpdateAfterBindResources > BINDLESS_RESERVED_RESOURCES ? limits.maxPerStageUpdateAfterBindResources - BINDLESS_RESERVED_RESOURCES : 0;
+        uint64_t budget = std::min(perStageBudget, limits.maxUpdateAfterBindDescriptorsInAllPools);
+        uint64_t total = (uint64_t)maxImages + maxSamplers + maxBuffers;
+        if (total > budget)
+        {
+            maxImages = std::max(1u, (uint32_t)(maxImages * budget / total)); //pool sizes can't be 0
+            maxSamplers = std::max(1u, (uint32_t)(maxSamplers * budget / total));
+            maxBuffers = std::max(1u, (uint32_t)(maxBuffers * budget / total));
+        }
+
+        bindlessTable = std::make_shared<BindlessResourceTable>(this, maxImages, maxSamplers, maxBuffers);
+        bindlessTable->Create();
+    }
+
+    pipelineManifest = std::make_shared<PipelineManifest>(this);
+    pipelineManifest->Load(PIPELINE_MANIFEST_PATH);
+}
+
 void GraphicsDevice::GetGPUProperties()
 {
     vkGetPhysicalDeviceProperties(physicalGPU, &gpuProperties);
@@ -1106,12 +1580,12 @@ void GraphicsDevice::GetGPUProperties()
 VkPresentModeKHR GraphicsDevice::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
 {
     for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+        if (availablePresentMode == preferredPresentMode) {
             return availablePresentMode;
         }
     }
 
-    return VK_PRESENT_MODE_FIFO_KHR;
+    return VK_PRESENT_MODE_FIFO_KHR; //the only mode the spec guarantees
 }
 
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger)
@@ -1159,7 +1633,7 @@ VkVertexInputBindingDescription VertexPositionColor::GetBindingDescription()
     return bindDesc;
 }
 
-bool QueueFamilyIndices::isComplete()
+bool QueueFamilyIndices::isComplete(bool requirePresent)
 {
-    return graphicsFamily.has_value() && presentFamily.has_value() && transferFamily.has_value() && computeFamily.has_value();
+    return graphicsFamily.has_value() && (presentFamily.has_value() || !requirePresent) && transferFamily.has_value() && computeFamily.has_value();
 }
\ No newline at end of file
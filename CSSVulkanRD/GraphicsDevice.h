@@ -1,7 +1,15 @@
 #pragma once
 #include "includes.h"
+#include "GPUQueue.h"
+#include "FrameAllocator.h"
+#include "DeviceContext.h"
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
+const VkDeviceSize FRAME_ALLOCATOR_SIZE = 4 * 1024 * 1024; //per frame in flight
+const uint32_t FRAME_DESCRIPTOR_SETS = 256; //first pool of each frame arena, grows on demand
+const uint32_t PERSISTENT_DESCRIPTOR_SETS = 64;
+const char* const PIPELINE_CACHE_PATH = "pipeline.cache"; //relative to the working directory
+const char* const PIPELINE_MANIFEST_PATH = "pipeline.manifest";
 
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger);
 void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT debugMessenger, const VkAllocationCallbacks* pAllocator); 
@@ -37,7 +45,7 @@ struct QueueFamilyIndices
     std::optional<uint32_t> computeFamily;
     uint32_t computeQueueCount;
 
-    bool isComplete();
+    bool isComplete(bool requirePresent = true);
 };
 
 struct SwapChainSupportDetails
@@ -56,14 +64,26 @@ struct ShaderDescriptor
 
 class Shader;
 class GPUMemoryManager;
+struct GPUMemoryAllocation;
 class DeviceContext;
+class ImageViewCache;
+class SamplerCache;
 struct InflightFrame;
 class PipelineState;
+class DeferredDeletionQueue;
+class PresentationController;
+class PipelineCache;
+class PipelineStateCache;
+class DescriptorLayoutCache;
+class DescriptorAllocator;
+class BindlessResourceTable;
+class PipelineManifest;
 
 class GraphicsDevice
 {
 public:
     GraphicsDevice(GLFWwindow* pAppWindow);
+    GraphicsDevice(VkExtent2D headlessExtent); //no window, surface or swapchain, renders into images owned by the device
     ~GraphicsDevice();
 
     void InitializeVulkan();
@@ -72,29 +92,63 @@ public:
     VkDevice GetGPU() const;
     VkPhysicalDevice GetPhysicalDevice() const;
     VkPhysicalDeviceProperties GetDeviceProperties() const;
+    bool SupportsPipelineLibrary() const; //VK_EXT_graphics_pipeline_library, PipelineState links pipelines from cached parts
+    bool SupportsExtendedDynamicState() const; //VK_EXT_extended_dynamic_state, cull mode/front face/topology/depth set while recording
+    bool SupportsBindless() const; //descriptor indexing: partially bound, update after bind, non uniform indexed arrays
+
+    bool IsHeadless() const;
+    VkImage GetBackbufferImage() const; //color target of the current frame, left in TRANSFER_SRC_OPTIMAL when headless
+    VkFormat GetBackbufferFormat() const;
 
     void ResizeFramebuffer();
 
-    void BeginRenderPass();
+    void SetPresentMode(VkPresentModeKHR mode); //FIFO, FIFO_RELAXED, MAILBOX or IMMEDIATE, applied at the end of the current frame. falls back to FIFO if unsupported
+    VkPresentModeKHR GetPresentMode() const;
+    std::vector<VkPresentModeKHR> GetSupportedPresentModes();
+    std::shared_ptr<PresentationController> GetPresentationController() const;
+
+    void BeginRenderPass(VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE); //SECONDARY_COMMAND_BUFFERS leaves pipeline binding to the secondaries
     void EndRenderPass();
 
+    VkCommandBufferInheritanceInfo GetRenderPassInheritance() const; //current render pass + framebuffer, for secondary command buffers
+
     void WaitForGPUIdle();
     void DrawFrame();
     int PrepareFrame();
 
-    void SetPushConstants(VkShaderStageFlags flags, size_t size, const void* pConstantData);
+    void SetPushConstants(VkShaderStageFlags flags, size_t size, const void* pConstantData, uint32_t offset = 0); //against the bound PipelineState's layout, unchanged bytes are skipped
 
     InflightFrame* GetCurrentFrame(); //likely an oversimplification
 
+    //transient per frame resources, valid until this ring slot comes back around
+    FrameAllocation AllocateFrameMemory(VkDeviceSize size, VkDeviceSize alignment = 0);
+    VkDescriptorSet AllocateFrameDescriptorSet(VkDescriptorSetLayout layout); //valid until the frame comes back around
+
     std::shared_ptr<GPUMemoryManager> GetMainGPUMemoryAllocator() const;
+    std::shared_ptr<ImageViewCache> GetImageViewCache() const;
+    std::shared_ptr<SamplerCache> GetSamplerCache() const;
+    std::shared_ptr<DeferredDeletionQueue> GetDeletionQueue(VkQueueFlagBits queueType = VK_QUEUE_GRAPHICS_BIT) const; //on that queue's timeline, sealed and collected every PrepareFrame
+    std::shared_ptr<PipelineCache> GetPipelineCache() const; //loaded from PIPELINE_CACHE_PATH at init, saved at shutdown
+    std::shared_ptr<PipelineStateCache> GetPipelineStateCache() const; //dedupes pipelines by content
+    std::shared_ptr<DescriptorLayoutCache> GetDescriptorLayoutCache() const; //set and pipeline layouts, shared by every compatible pipeline
+    std::shared_ptr<PipelineManifest> GetPipelineManifest() const; //loaded at init, WarmUp it before the first frame
 
-    void PrimaryGraphicsQueueSubmit(VkSubmitInfo submitInfo, bool block=false);
-    void PrimaryTransferQueueSubmit(uint32_t transferQueueIndex, VkSubmitInfo submitInfo, bool block=false);
+    uint64_t PrimaryGraphicsQueueSubmit(VkSubmitInfo submitInfo, bool block=false); //returns the queue timeline point
+    uint64_t PrimaryTransferQueueSubmit(uint32_t transferQueueIndex, VkSubmitInfo submitInfo, bool block=false);
+
+    GPUQueue* GetGPUQueue(VkQueueFlagBits queueType) const;
+    void FlushQueues(); //pushes every batched submission to the driver, one vkQueueSubmit per queue
+    QueueSubmitStats GetLastFrameSubmitStats() const; //summed over all queues
 
     VkQueue GetTransferQueue(uint32_t index);
     VkQueue GetComputeQueue(uint32_t index);
 
     std::shared_ptr<DeviceContext> GetTransferContext() const;
+    std::shared_ptr<DeviceContext> GetComputeContext() const; //records on the async compute queue
+
+    //makes the current frame's graphics submission wait on a point of another queue's timeline,
+    //e.g. AddFrameWait(computeQueue->WaitFor(value, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT)) after submitting culling
+    void AddFrameWait(const SemaphoreWait& wait);
 
     std::shared_ptr<DeviceContext> ImmediateContext;
     std::shared_ptr<DeviceContext> TransferContext;
@@ -112,12 +166,12 @@ public:
 
     VkRenderPass GetRenderPass() const;
 
-    VkDescriptorPool GetDescriptorPool() const; //deprecated soon
+    std::shared_ptr<DescriptorAllocator> GetDescriptorAllocator() const; //long lived sets, free them individually
+    std::shared_ptr<BindlessResourceTable> GetBindlessResourceTable() const; //nullptr unless SupportsBindless
 
     PipelineState* GetPipelineState() const;
+    PipelineState* GetBoundPipelineState() const; //what BeginRenderPass actually bound: the state, its fallback while compiling, or nullptr
 private:
-    Shader* pShader; //refactor
-
     GLFWwindow* pApplicationWindow;
 
     VkInstance instance;
@@ -129,42 +183,53 @@ private:
     VkSurfaceKHR surface;
     VkQueue presentQueue;
     VkSwapchainKHR swapChain;
-    VkPipelineLayout pipelineLayout;
     VkRenderPass renderPass;
 
-    VkPipeline graphicsPipeline;
     PipelineState* pPipelineState; //deprecated
-
-    VkDescriptorSetLayout descriptorSetLayout; //deprecated
+    PipelineState* pBoundPipelineState = nullptr;
 
     VkQueue primaryGraphicsQueue; //this is queue index 0 of the GPUs main graphics queue family
 
     std::vector<VkQueue> transferQueues;
     std::vector<VkQueue> computeQueues;
 
+    std::shared_ptr<GPUQueue> graphicsQueue;
+    std::shared_ptr<GPUQueue> transferQueue;
+    std::shared_ptr<GPUQueue> computeQueue;
+    std::shared_ptr<GPUQueue> presentGPUQueue; //same object as graphicsQueue when present shares its VkQueue
+    void createGPUQueues();
+    std::vector<GPUQueue*> getUniqueQueues() const; //families without dedicated queues share one GPUQueue
+
+    QueueSubmitStats lastFrameSubmitStats;
+
     std::shared_ptr<DeviceContext> immediateContext;
     std::shared_ptr<DeviceContext> transferContext;
+    std::shared_ptr<DeviceContext> computeContext;
+
+    std::vector<SemaphoreWait> frameWaits; //consumed by DrawFrame
 
     VkFormat swapChainImageFormat;
     VkExtent2D swapChainExtent;
 
+    bool headless;
+    VkExtent2D headlessExtent;
+    std::vector<GPUMemoryAllocation*> headlessImageMemory;
+    void createHeadlessTargets();
+    void destroyHeadlessTargets();
+
     void initVulkan();
 
     void cleanup();
     void createInstance();
     void createLogicalDevice();
-    void createSwapChain();
+    void createSwapChain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
     void createImageViews();
-    void createGraphicsPipeline();
     void createRenderPass();
     void createFramebuffers();
     void createCommandPools();
-    void createDescriptorSetLayout();
     void recreateSwapChain();
     void cleanupSwapchain();
     void CreateSurface();
-    void createDescriptorPool();
-    void createDescriptorSets();
 
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
     void setupDebugMessenger();
@@ -186,6 +251,15 @@ private:
     QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice physicalGPU);
     bool IsDeviceSuitable(VkPhysicalDevice physicalGPU);
     bool CheckDeviceExtensionSupport(VkPhysicalDevice physicalGPU);
+    std::vector<const char*> getRequiredDeviceExtensions() const;
+    void queryOptionalFeatures(); //enabled when present, never required for device selection
+    std::vector<const char*> optionalDeviceExtensions;
+    bool pipelineLibrarySupported = false;
+    bool extendedDynamicStateSupported = false;
+    bool bindlessSupported = false;
+    VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties = {};
+    ExtendedDynamicStateFunctions extendedDynamicState = {};
+    void loadExtendedDynamicState();
     void PickPhysicalGPU();
 
     SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice physicalGPU);
@@ -198,9 +272,7 @@ private:
     std::vector<VkFramebuffer>   swapChainFramebuffers;
     //----
 
-    VkDescriptorPool descriptorPool; //eventually move this into DeviceContext
     std::vector<ShaderDescriptor*> registeredDescriptors;
-    std::vector<VkDescriptorSet> descriptorSets;
 
     size_t currentFrame = 0;
     bool framebufferResized = false;
@@ -209,12 +281,30 @@ private:
     std::vector<InflightFrame*> inflightFrames;
     InflightFrame* GetAvailableFrame();
     InflightFrame* CreateInflightFrame();
+    void createFrameRing();
+    void destroyFrameRing();
     InflightFrame* pActiveFrame = nullptr;
-    VkFence acquireImageFence;
 
     std::shared_ptr<GPUMemoryManager> memoryManager;
     void initializeMainMemoryManager();
 
+    std::shared_ptr<ImageViewCache> imageViewCache;
+    std::shared_ptr<SamplerCache> samplerCache;
+    std::shared_ptr<DeferredDeletionQueue> deletionQueue;
+    std::shared_ptr<DeferredDeletionQueue> computeDeletionQueue; //same as deletionQueue when compute shares the graphics queue
+    std::shared_ptr<PipelineCache> pipelineCache;
+    std::shared_ptr<PipelineStateCache> pipelineStateCache;
+    std::shared_ptr<DescriptorLayoutCache> descriptorLayoutCache;
+    std::shared_ptr<DescriptorAllocator> descriptorAllocator;
+    std::shared_ptr<BindlessResourceTable> bindlessTable;
+    std::shared_ptr<PipelineManifest> pipelineManifest;
+
+    std::shared_ptr<PresentationController> presentation;
+    VkPresentModeKHR preferredPresentMode;
+    VkPresentModeKHR presentMode;
+    bool presentModeChanged;
+    void createObjectCaches();
+
     VkPhysicalDeviceProperties gpuProperties;
     void GetGPUProperties();
 
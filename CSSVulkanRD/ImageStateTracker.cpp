@@ -0,0 +1,177 @@
+#include "ImageStateTracker.h"
+
+static const VkAccessFlags WRITE_ACCESS_MASK = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+	VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+static const VkPipelineStageFlags SHADER_STAGES = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+ImageUsageState GetImageUsageState(ImageUsage usage)
+{
+	switch (usage)
+	{
+		case ImageUsage::CopySrc:
+			return { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT };
+		case ImageUsage::CopyDst:
+			return { VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT };
+		case ImageUsage::Sampled:
+			return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, SHADER_STAGES };
+		case ImageUsage::Storage:
+			return { VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, SHADER_STAGES };
+		case ImageUsage::ColorAttachment:
+			return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+		case ImageUsage::DepthAttachment:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT };
+		case ImageUsage::Present:
+			return { VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT };
+		case ImageUsage::Undefined:
+		default:
+			return { VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT };
+	}
+}
+
+BarrierBatch::BarrierBatch()
+{
+	srcStages = 0;
+	dstStages = 0;
+}
+
+BarrierBatch::~BarrierBatch()
+{
+}
+
+void BarrierBatch::AddImageBarrier(const VkImageMemoryBarrier& barrier, VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages)
+{
+	imageBarriers.push_back(barrier);
+	this->srcStages |= srcStages;
+	this->dstStages |= dstStages;
+}
+
+void BarrierBatch::Flush(VkCommandBuffer cmdBuffer)
+{
+	if (imageBarriers.empty())
+		return;
+
+	vkCmdPipelineBarrier(cmdBuffer,
+		srcStages, dstStages,
+		0,
+		0, nullptr,
+		0, nullptr,
+		static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+
+	imageBarriers.clear();
+	srcStages = 0;
+	dstStages = 0;
+}
+
+bool BarrierBatch::IsEmpty() const
+{
+	return imageBarriers.empty();
+}
+
+ImageStateTracker::ImageStateTracker()
+{
+	image = VK_NULL_HANDLE;
+	aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	mipLevels = 0;
+	arrayLayers = 0;
+}
+
+ImageStateTracker::~ImageStateTracker()
+{
+}
+
+void ImageStateTracker::Initialize(VkImage image, VkImageAspectFlags aspect, uint32_t mipLevels, uint32_t arrayLayers, VkImageLayout initialLayout)
+{
+	this->image = image;
+	this->aspect = aspect;
+	this->mipLevels = mipLevels;
+	this->arrayLayers = arrayLayers;
+
+	subresources.assign((size_t)mipLevels * arrayLayers, { initialLayout, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT });
+}
+
+void ImageStateTracker::Transition(BarrierBatch& batch, ImageUsage usage)
+{
+	Transition(batch, usage, 0, mipLevels, 0, arrayLayers);
+}
+
+void ImageStateTracker::Transition(BarrierBatch& batch, ImageUsage usage, uint32_t baseMip, uint32_t mipCount, uint32_t baseLayer, uint32_t layerCount)
+{
+	ImageUsageState next = GetImageUsageState(usage);
+
+	if (usage == ImageUsage::Undefined)
+	{
+		//discard, no barrier now. the next transition starts from UNDEFINED but still waits on the last access
+		for (uint32_t mip = baseMip; mip < baseMip + mipCount; ++mip)
+			for (uint32_t layer = baseLayer; layer < baseLayer + layerCount; ++layer)
+				subresources[(size_t)mip * arrayLayers + layer].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		return;
+	}
+
+	for (uint32_t mip = baseMip; mip < baseMip + mipCount; ++mip)
+	{
+		//runs of layers that share the same previous state become a single barrier
+		uint32_t layer = baseLayer;
+		while (layer < baseLayer + layerCount)
+		{
+			ImageUsageState current = subresources[(size_t)mip * arrayLayers + layer];
+
+			uint32_t runEnd = layer + 1;
+			while (runEnd < baseLayer + layerCount)
+			{
+				const ImageUsageState& s = subresources[(size_t)mip * arrayLayers + runEnd];
+				if (s.layout != current.layout || s.access != current.access || s.stages != current.stages)
+					break;
+				++runEnd;
+			}
+
+			if (needsBarrier(current, next))
+			{
+				VkImageMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.srcAccessMask = current.access & WRITE_ACCESS_MASK; //only writes need to be made available
+				barrier.dstAccessMask = next.access;
+				barrier.oldLayout = current.layout;
+				barrier.newLayout = next.layout;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.image = image;
+				barrier.subresourceRange.aspectMask = aspect;
+				barrier.subresourceRange.baseMipLevel = mip;
+				barrier.subresourceRange.levelCount = 1;
+				barrier.subresourceRange.baseArrayLayer = layer;
+				barrier.subresourceRange.layerCount = runEnd - layer;
+
+				batch.AddImageBarrier(barrier, current.stages, next.stages);
+
+				for (uint32_t l = layer; l < runEnd; ++l)
+					subresources[(size_t)mip * arrayLayers + l] = next;
+			}
+			else
+			{
+				//read after read in the same layout, just widen what has to be waited on next time
+				for (uint32_t l = layer; l < runEnd; ++l)
+				{
+					subresources[(size_t)mip * arrayLayers + l].access |= next.access;
+					subresources[(size_t)mip * arrayLayers + l].stages |= next.stages;
+				}
+			}
+
+			layer = runEnd;
+		}
+	}
+}
+
+VkImageLayout ImageStateTracker::GetLayout(uint32_t mip, uint32_t layer) const
+{
+	return subresources[(size_t)mip * arrayLayers + layer].layout;
+}
+
+bool ImageStateTracker::needsBarrier(const ImageUsageState& current, const ImageUsageState& next)
+{
+	if (current.layout != next.layout)
+		return true;
+
+	return (current.access & WRITE_ACCESS_MASK) || (next.access & WRITE_ACCESS_MASK);
+}
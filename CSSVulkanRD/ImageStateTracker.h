@@ -0,0 +1,65 @@
+#pragma once
+#include "includes.h"
+
+//what an image subresource is about to be used for. layouts, access masks and stages are derived from this
+enum class ImageUsage
+{
+	Undefined, //contents can be discarded
+	CopySrc,
+	CopyDst,
+	Sampled,
+	Storage,
+	ColorAttachment,
+	DepthAttachment,
+	Present
+};
+
+struct ImageUsageState
+{
+	VkImageLayout        layout;
+	VkAccessFlags        access;
+	VkPipelineStageFlags stages;
+};
+
+ImageUsageState GetImageUsageState(ImageUsage usage);
+
+//collects barriers so a transition point costs one vkCmdPipelineBarrier no matter how many images/subresources change
+class BarrierBatch
+{
+public:
+	BarrierBatch();
+	~BarrierBatch();
+
+	void AddImageBarrier(const VkImageMemoryBarrier& barrier, VkPipelineStageFlags srcStages, VkPipelineStageFlags dstStages);
+	void Flush(VkCommandBuffer cmdBuffer);
+
+	bool IsEmpty() const;
+private:
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	VkPipelineStageFlags srcStages;
+	VkPipelineStageFlags dstStages;
+};
+
+//tracks layout and last access of every mip/layer of one image
+class ImageStateTracker
+{
+public:
+	ImageStateTracker();
+	~ImageStateTracker();
+
+	void Initialize(VkImage image, VkImageAspectFlags aspect, uint32_t mipLevels, uint32_t arrayLayers, VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+	void Transition(BarrierBatch& batch, ImageUsage usage);
+	void Transition(BarrierBatch& batch, ImageUsage usage, uint32_t baseMip, uint32_t mipCount, uint32_t baseLayer, uint32_t layerCount);
+
+	VkImageLayout GetLayout(uint32_t mip, uint32_t layer) const;
+private:
+	VkImage image;
+	VkImageAspectFlags aspect;
+	uint32_t mipLevels;
+	uint32_t arrayLayers;
+
+	std::vector<ImageUsageState> subresources; //mip major
+
+	static bool needsBarrier(const ImageUsageState& current, const ImageUsageState& next);
+};
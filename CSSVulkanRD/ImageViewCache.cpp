@@ -0,0 +1,146 @@
+#include "ImageViewCache.h"
+
+ImageViewCache::ImageViewCache(VkDevice GPU)
+{
+	this->GPU = GPU;
+}
+
+ImageViewCache::~ImageViewCache()
+{
+}
+
+VkImageView ImageViewCache::Acquire(const VkImageViewCreateInfo& viewInfo)
+{
+	if (viewInfo.pNext != nullptr)
+		throw std::runtime_error("image view cache does not support extension structures"); //can't hash what we can't see
+
+	std::lock_guard<std::mutex> _lock(lock);
+
+	size_t hash = hashViewInfo(viewInfo);
+
+	auto range = views.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (viewInfoEqual(it->second->info, viewInfo))
+		{
+			it->second->refCount++;
+			return it->second->view;
+		}
+	}
+
+	CachedView* pView = new CachedView();
+	pView->info = viewInfo;
+	pView->refCount = 1;
+	pView->hash = hash;
+
+	VULKAN_CALL_ERROR(vkCreateImageView(GPU, &viewInfo, nullptr, &pView->view), "failed to create image view");
+
+	views.insert({ hash, pView });
+	viewLookup[pView->view] = pView;
+
+	return pView->view;
+}
+
+void ImageViewCache::Release(VkImageView view)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	auto it = viewLookup.find(view);
+	if (it == viewLookup.end())
+		return;
+
+	if (--it->second->refCount == 0)
+		destroyView(it->second);
+}
+
+void ImageViewCache::ReleaseImage(VkImage image)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	std::vector<CachedView*> imageViews;
+	for (auto& entry : viewLookup)
+	{
+		if (entry.second->info.image == image)
+			imageViews.push_back(entry.second);
+	}
+
+	for (CachedView* pView : imageViews)
+	{
+		assert(pView->refCount == 0 && "image destroyed while a cached view of it is still referenced");
+		destroyView(pView);
+	}
+}
+
+uint32_t ImageViewCache::GetViewCount()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+	return (uint32_t)viewLookup.size();
+}
+
+void ImageViewCache::Destroy()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	for (auto& entry : viewLookup)
+	{
+		vkDestroyImageView(GPU, entry.second->view, nullptr);
+		delete entry.second;
+	}
+
+	views.clear();
+	viewLookup.clear();
+}
+
+size_t ImageViewCache::hashViewInfo(const VkImageViewCreateInfo& viewInfo)
+{
+	size_t hash = 0;
+	HashCombine(hash, viewInfo.flags);
+	HashCombine(hash, viewInfo.image);
+	HashCombine(hash, viewInfo.viewType);
+	HashCombine(hash, viewInfo.format);
+	HashCombine(hash, viewInfo.components.r);
+	HashCombine(hash, viewInfo.components.g);
+	HashCombine(hash, viewInfo.components.b);
+	HashCombine(hash, viewInfo.components.a);
+	HashCombine(hash, viewInfo.subresourceRange.aspectMask);
+	HashCombine(hash, viewInfo.subresourceRange.baseMipLevel);
+	HashCombine(hash, viewInfo.subresourceRange.levelCount);
+	HashCombine(hash, viewInfo.subresourceRange.baseArrayLayer);
+	HashCombine(hash, viewInfo.subresourceRange.layerCount);
+	return hash;
+}
+
+bool ImageViewCache::viewInfoEqual(const VkImageViewCreateInfo& a, const VkImageViewCreateInfo& b)
+{
+	return a.flags == b.flags &&
+		a.image == b.image &&
+		a.viewType == b.viewType &&
+		a.format == b.format &&
+		a.components.r == b.components.r &&
+		a.components.g == b.components.g &&
+		a.components.b == b.components.b &&
+		a.components.a == b.components.a &&
+		a.subresourceRange.aspectMask == b.subresourceRange.aspectMask &&
+		a.subresourceRange.baseMipLevel == b.subresourceRange.baseMipLevel &&
+		a.subresourceRange.levelCount == b.subresourceRange.levelCount &&
+		a.subresourceRange.baseArrayLayer == b.subresourceRange.baseArrayLayer &&
+		a.subresourceRange.layerCount == b.subresourceRange.layerCount;
+}
+
+void ImageViewCache::destroyView(CachedView* pView)
+{
+	vkDestroyImageView(GPU, pView->view, nullptr);
+
+	auto range = views.equal_range(pView->hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second == pView)
+		{
+			views.erase(it);
+			break;
+		}
+	}
+
+	viewLookup.erase(pView->view);
+	delete pView;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "includes.h"
+#include <unordered_map>
+
+//hands out shared, refcounted image views. identical create infos resolve to the same VkImageView
+class ImageViewCache
+{
+public:
+	ImageViewCache(VkDevice GPU);
+	~ImageViewCache();
+
+	VkImageView Acquire(const VkImageViewCreateInfo& viewInfo);
+	void Release(VkImageView view);
+	//teardown check, call before destroying the image once its owner has released its own views.
+	//any view still referenced is a leak by another user, asserted and evicted so a recycled VkImage handle can't hit it
+	void ReleaseImage(VkImage image);
+
+	uint32_t GetViewCount();
+
+	void Destroy();
+private:
+	struct CachedView
+	{
+		VkImageViewCreateInfo info;
+		VkImageView view;
+		uint32_t refCount;
+		size_t hash;
+	};
+
+	std::unordered_multimap<size_t, CachedView*> views;
+	std::unordered_map<VkImageView, CachedView*> viewLookup;
+
+	std::mutex lock;
+	VkDevice GPU;
+
+	static size_t hashViewInfo(const VkImageViewCreateInfo& viewInfo);
+	static bool viewInfoEqual(const VkImageViewCreateInfo& a, const VkImageViewCreateInfo& b);
+	void destroyView(CachedView* pView);
+};
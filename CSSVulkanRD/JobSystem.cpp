@@ -0,0 +1,440 @@
+#include "JobSystem.h"
+#include <chrono>
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+
+static thread_local int32_t currentWorkerIndex = -1;
+static thread_local JobSystem* currentJobSystem = nullptr;
+
+WorkStealingDeque::WorkStealingDeque(uint32_t capacity)
+{
+	top = 0;
+	bottom = 0;
+	buffer.reset(new std::atomic<Job*>[capacity]);
+	mask = capacity - 1;
+}
+
+WorkStealingDeque::~WorkStealingDeque()
+{
+}
+
+bool WorkStealingDeque::Push(Job* pJob)
+{
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if (b - t > mask)
+		return false;
+
+	buffer[b & mask].store(pJob, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+Job* WorkStealingDeque::Pop()
+{
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+
+	if (t > b)
+	{
+		bottom.store(b + 1, std::memory_order_relaxed); //empty
+		return nullptr;
+	}
+
+	Job* pJob = buffer[b & mask].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		//last job, race the thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			pJob = nullptr;
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return pJob;
+}
+
+Job* WorkStealingDeque::Steal()
+{
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+
+	if (t >= b)
+		return nullptr;
+
+	Job* pJob = buffer[t & mask].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return nullptr; //lost to another thief or the owner
+	return pJob;
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+	queuedJobs = 0;
+	shutdown = false;
+
+	if (workerCount == 0)
+		workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+	for (uint32_t i = 0; i < workerCount; ++i)
+		deques.emplace_back(new WorkStealingDeque());
+
+	for (uint32_t i = 0; i < workerCount; ++i)
+		workers.emplace_back(&JobSystem::workerMain, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	Shutdown();
+}
+
+JobHandle JobSystem::Schedule(JobFunction function)
+{
+	JobHandle counter = createCounter(1);
+	releaseJob(createJob(function, counter));
+	return counter;
+}
+
+JobHandle JobSystem::Schedule(JobFunction function, const JobHandle& dependency)
+{
+	JobHandle counter = createCounter(1);
+	Job* pJob = createJob(function, counter);
+	addDependency(pJob, dependency);
+	releaseJob(pJob);
+	return counter;
+}
+
+JobHandle JobSystem::Schedule(JobFunction function, std::initializer_list<JobHandle> dependencies)
+{
+	return Schedule(function, std::vector<JobHandle>(dependencies));
+}
+
+JobHandle JobSystem::Schedule(JobFunction function, const std::vector<JobHandle>& dependencies)
+{
+	JobHandle counter = createCounter(1);
+	Job* pJob = createJob(function, counter);
+	for (const JobHandle& dependency : dependencies)
+		addDependency(pJob, dependency);
+	releaseJob(pJob);
+	return counter;
+}
+
+JobHandle JobSystem::ParallelForAsync(uint32_t count, uint32_t grainSize, std::function<void(uint32_t begin, uint32_t end)> function, const JobHandle& dependency)
+{
+	grainSize = std::max(grainSize, 1u);
+	uint32_t chunks = (count + grainSize - 1) / grainSize;
+
+	if (chunks == 0)
+		return Schedule([]() {}, dependency);
+
+	//every chunk decrements the same counter, the handle completes with the last one
+	JobHandle counter = createCounter(chunks);
+	for (uint32_t chunk = 0; chunk < chunks; ++chunk)
+	{
+		uint32_t begin = chunk * grainSize;
+		uint32_t end = std::min(begin + grainSize, count);
+
+		Job* pJob = createJob([function, begin, end]() { function(begin, end); }, counter);
+		addDependency(pJob, dependency);
+		releaseJob(pJob);
+	}
+	return counter;
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t begin, uint32_t end)> function)
+{
+	Wait(ParallelForAsync(count, grainSize, function));
+}
+
+void JobSystem::Wait(const JobHandle& handle)
+{
+	if (!handle)
+		return;
+
+	uint32_t spins = 0;
+	while (!IsComplete(handle))
+	{
+		int32_t self = currentJobSystem == this ? currentWorkerIndex : -1;
+		Job* pJob = findJob(self >= 0 ? (uint32_t)self : 0);
+		if (pJob)
+		{
+			execute(pJob);
+			spins = 0;
+		}
+		else if (++spins > 64)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> _lock(handle->lock);
+		error = handle->error;
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
+
+bool JobSystem::IsComplete(const JobHandle& handle) const
+{
+	return !handle || handle->remaining.load(std::memory_order_acquire) == 0;
+}
+
+uint32_t JobSystem::GetWorkerCount() const
+{
+	return (uint32_t)deques.size();
+}
+
+int32_t JobSystem::GetCurrentWorkerIndex() const
+{
+	return currentJobSystem == this ? currentWorkerIndex : -1;
+}
+
+void JobSystem::Shutdown()
+{
+	if (shutdown.exchange(true))
+		return;
+
+	{
+		std::lock_guard<std::mutex> _lock(sleepLock);
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+	workers.clear();
+}
+
+JobHandle JobSystem::createCounter(uint32_t jobCount)
+{
+	JobHandle counter = std::make_shared<JobCounter>();
+	counter->remaining = jobCount;
+	counter->done = false;
+	return counter;
+}
+
+Job* JobSystem::createJob(JobFunction function, const JobHandle& completion)
+{
+	Job* pJob = new Job();
+	pJob->function = std::move(function);
+	pJob->completion = completion;
+	pJob->unresolvedDependencies = 1; //guard so the job can't start while dependencies are still being added
+	return pJob;
+}
+
+void JobSystem::addDependency(Job* pJob, const JobHandle& dependency)
+{
+	if (!dependency)
+		return;
+
+	std::lock_guard<std::mutex> _lock(dependency->lock);
+	if (dependency->done)
+		return;
+
+	pJob->unresolvedDependencies++;
+	dependency->continuations.push_back(pJob);
+}
+
+void JobSystem::releaseJob(Job* pJob)
+{
+	if (pJob->unresolvedDependencies.fetch_sub(1) == 1)
+		enqueue(pJob);
+}
+
+void JobSystem::enqueue(Job* pJob)
+{
+	int32_t self = GetCurrentWorkerIndex();
+	if (self < 0 || !deques[self]->Push(pJob))
+	{
+		std::lock_guard<std::mutex> _lock(injectionLock);
+		injectionQueue.push_back(pJob);
+	}
+
+	queuedJobs.fetch_add(1);
+
+	{
+		std::lock_guard<std::mutex> _lock(sleepLock); //pairs with the predicate check so the wake can't be lost
+	}
+	wake.notify_one();
+}
+
+Job* JobSystem::findJob(uint32_t startIndex)
+{
+	Job* pJob = nullptr;
+
+	int32_t self = GetCurrentWorkerIndex();
+	if (self >= 0)
+		pJob = deques[self]->Pop();
+
+	if (!pJob)
+	{
+		std::lock_guard<std::mutex> _lock(injectionLock);
+		if (!injectionQueue.empty())
+		{
+			pJob = injectionQueue.front();
+			injectionQueue.pop_front();
+		}
+	}
+
+	for (uint32_t i = 1; !pJob && i <= deques.size(); ++i)
+	{
+		uint32_t victim = (startIndex + i) % deques.size();
+		if ((int32_t)victim != self)
+			pJob = deques[victim]->Steal();
+	}
+
+	if (pJob)
+		queuedJobs.fetch_sub(1);
+	return pJob;
+}
+
+void JobSystem::execute(Job* pJob)
+{
+	JobHandle completion = pJob->completion;
+
+	//an escaping exception would terminate a worker, or skip the decrement below and leave every waiter spinning
+	try
+	{
+		pJob->function();
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> _lock(completion->lock);
+		if (!completion->error)
+			completion->error = std::current_exception();
+	}
+
+	delete pJob;
+
+	if (completion->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		complete(completion);
+}
+
+void JobSystem::complete(const JobHandle& counter)
+{
+	std::vector<Job*> continuations;
+	{
+		std::lock_guard<std::mutex> _lock(counter->lock);
+		counter->done = true;
+		continuations.swap(counter->continuations);
+	}
+
+	for (Job* pJob : continuations)
+		releaseJob(pJob);
+}
+
+void JobSystem::workerMain(uint32_t workerIndex)
+{
+	currentWorkerIndex = (int32_t)workerIndex;
+	currentJobSystem = this;
+
+	uint32_t idleSpins = 0;
+	while (true)
+	{
+		Job* pJob = findJob(workerIndex);
+		if (pJob)
+		{
+			execute(pJob);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (shutdown)
+			return;
+
+		if (++idleSpins < 64)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> _lock(sleepLock);
+		wake.wait(_lock, [this]() { return shutdown || queuedJobs.load() > 0; });
+		idleSpins = 0;
+	}
+}
+
+static void benchmarkWork(uint32_t iterations)
+{
+	volatile float sink = 0.0f;
+	float value = 1.0f;
+	for (uint32_t i = 0; i < iterations; ++i)
+		value = std::sqrt(value * 1.0001f + (float)i);
+	sink = value;
+	(void)sink;
+}
+
+std::vector<JobBenchmarkResult> RunJobSystemBenchmark(uint32_t maxWorkers)
+{
+	typedef std::chrono::high_resolution_clock clock;
+
+	if (maxWorkers == 0)
+		maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+	const uint32_t wideJobs = 8192;
+	const uint32_t layers = 64;
+	const uint32_t jobsPerLayer = 128;
+	const uint32_t forCount = 1 << 18;
+	const uint32_t work = 2000;
+
+	std::vector<JobBenchmarkResult> results;
+
+	printf("job system scaling benchmark (%u hardware threads)\n", std::thread::hardware_concurrency());
+	printf("workers |   wide ms | layered ms |  par-for ms | wide speedup | layered speedup | par-for speedup\n");
+
+	for (uint32_t workerCount = 1; workerCount <= maxWorkers; workerCount = workerCount < maxWorkers ? std::min(workerCount * 2, maxWorkers) : workerCount + 1)
+	{
+		JobSystem jobs(workerCount);
+		JobBenchmarkResult result{};
+		result.workerCount = workerCount;
+
+		//wide: lots of independent jobs joined by one wait
+		{
+			auto start = clock::now();
+			std::vector<JobHandle> handles;
+			handles.reserve(wideJobs);
+			for (uint32_t i = 0; i < wideJobs; ++i)
+				handles.push_back(jobs.Schedule([work]() { benchmarkWork(work); }));
+			for (const JobHandle& handle : handles)
+				jobs.Wait(handle);
+			result.wideGraphMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		}
+
+		//layered: every layer fans out and waits on the whole previous layer through one barrier continuation
+		{
+			auto start = clock::now();
+			JobHandle previousLayer;
+			for (uint32_t layer = 0; layer < layers; ++layer)
+				previousLayer = jobs.ParallelForAsync(jobsPerLayer, 1, [work](uint32_t, uint32_t) { benchmarkWork(work); }, previousLayer);
+			jobs.Wait(previousLayer);
+			result.layeredGraphMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		}
+
+		//fine grained data parallel loop
+		{
+			std::vector<float> data(forCount, 1.0f);
+			auto start = clock::now();
+			jobs.ParallelFor(forCount, 1024, [&data](uint32_t begin, uint32_t end)
+			{
+				for (uint32_t i = begin; i < end; ++i)
+					data[i] = std::sqrt(data[i] * (float)i + 1.0f) * 0.5f;
+			});
+			result.parallelForMs = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		}
+
+		results.push_back(result);
+
+		const JobBenchmarkResult& baseline = results.front();
+		printf("%7u | %9.2f | %10.2f | %11.2f | %11.2fx | %14.2fx | %14.2fx\n",
+			workerCount, result.wideGraphMs, result.layeredGraphMs, result.parallelForMs,
+			baseline.wideGraphMs / result.wideGraphMs,
+			baseline.layeredGraphMs / result.layeredGraphMs,
+			baseline.parallelForMs / result.parallelForMs);
+	}
+
+	return results;
+}
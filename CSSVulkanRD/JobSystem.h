@@ -0,0 +1,112 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <initializer_list>
+#include <cstdint>
+#include <exception>
+
+typedef std::function<void()> JobFunction;
+
+struct Job;
+
+//counts outstanding jobs. a handle is complete when every job it counts has run,
+//jobs scheduled with it as a dependency are continuations and only become runnable then
+struct JobCounter
+{
+	std::atomic<uint32_t> remaining;
+
+	std::mutex lock;
+	bool done;
+	std::vector<Job*> continuations;
+	std::exception_ptr error; //first exception thrown by a counted job, rethrown by Wait
+};
+
+typedef std::shared_ptr<JobCounter> JobHandle;
+
+struct Job
+{
+	JobFunction function;
+	JobHandle completion;
+	std::atomic<uint32_t> unresolvedDependencies;
+};
+
+//lock free single owner deque (Chase-Lev). the owning worker pushes/pops at the bottom, everyone else steals from the top
+class WorkStealingDeque
+{
+public:
+	WorkStealingDeque(uint32_t capacity = 4096); //power of two
+	~WorkStealingDeque();
+
+	bool Push(Job* pJob); //owner only, false when full
+	Job* Pop(); //owner only
+	Job* Steal(); //any thread
+private:
+	std::atomic<int64_t> top;
+	std::atomic<int64_t> bottom;
+	std::unique_ptr<std::atomic<Job*>[]> buffer;
+	int64_t mask;
+};
+
+class JobSystem
+{
+public:
+	JobSystem(uint32_t workerCount = 0); //0 = one worker per core
+	~JobSystem();
+
+	JobHandle Schedule(JobFunction function);
+	JobHandle Schedule(JobFunction function, const JobHandle& dependency);
+	JobHandle Schedule(JobFunction function, std::initializer_list<JobHandle> dependencies);
+	JobHandle Schedule(JobFunction function, const std::vector<JobHandle>& dependencies);
+
+	//splits [0,count) into chunks of grainSize and runs them across the workers
+	JobHandle ParallelForAsync(uint32_t count, uint32_t grainSize, std::function<void(uint32_t begin, uint32_t end)> function, const JobHandle& dependency = nullptr);
+	void ParallelFor(uint32_t count, uint32_t grainSize, std::function<void(uint32_t begin, uint32_t end)> function);
+
+	void Wait(const JobHandle& handle); //runs other jobs while waiting instead of blocking the thread, rethrows a job's exception
+	bool IsComplete(const JobHandle& handle) const;
+
+	uint32_t GetWorkerCount() const;
+	int32_t GetCurrentWorkerIndex() const; //-1 when called from a thread the job system doesn't own
+
+	void Shutdown();
+private:
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<WorkStealingDeque>> deques;
+
+	std::mutex injectionLock; //jobs from outside threads, or overflow from a full deque
+	std::deque<Job*> injectionQueue;
+
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	std::atomic<int32_t> queuedJobs;
+	std::atomic<bool> shutdown;
+
+	JobHandle createCounter(uint32_t jobCount);
+	Job* createJob(JobFunction function, const JobHandle& completion);
+	void addDependency(Job* pJob, const JobHandle& dependency);
+	void releaseJob(Job* pJob); //drops the scheduling guard, enqueues if nothing else is pending
+
+	void enqueue(Job* pJob);
+	Job* findJob(uint32_t startIndex);
+	void execute(Job* pJob);
+	void complete(const JobHandle& counter);
+
+	void workerMain(uint32_t workerIndex);
+};
+
+struct JobBenchmarkResult
+{
+	uint32_t workerCount;
+	double   wideGraphMs;   //independent jobs
+	double   layeredGraphMs; //layers of jobs that depend on the whole previous layer
+	double   parallelForMs;
+};
+
+//runs synthetic task graphs with 1..maxWorkers workers and prints the scaling table
+std::vector<JobBenchmarkResult> RunJobSystemBenchmark(uint32_t maxWorkers = 0);
@@ -0,0 +1,60 @@
+#include "ParallelCommandRecorder.h"
+#include "GraphicsDevice.h"
+#include "DeviceContext.h"
+#include "JobSystem.h"
+
+ParallelCommandRecorder::ParallelCommandRecorder(GraphicsDevice* pDevice, JobSystem* pJobs)
+{
+	this->pDevice = pDevice;
+	this->pJobs = pJobs;
+}
+
+ParallelCommandRecorder::~ParallelCommandRecorder()
+{
+}
+
+void ParallelCommandRecorder::Record(uint32_t taskCount, RecordFunction recordFunc)
+{
+	if (taskCount == 0)
+		return;
+
+	VkCommandBufferInheritanceInfo inheritance = pDevice->GetRenderPassInheritance();
+	VkExtent2D extent = pDevice->GetSwapchainExtent();
+	VkViewport viewport = { 0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f };
+	VkRect2D scissor = { { 0, 0 }, extent };
+	auto context = pDevice->ImmediateContext;
+
+	secondaryCommandBuffers.assign(taskCount, VK_NULL_HANDLE);
+
+	std::mutex errorLock;
+	std::exception_ptr error;
+
+	//calling thread helps out while it waits, so this also works with a single worker
+	pJobs->ParallelFor(taskCount, 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t task = begin; task < end; ++task)
+		{
+			try
+			{
+				//pool comes from this thread's arena, so no two threads ever record from the same VkCommandPool
+				CommandBuffer* cmd = context->GetSecondaryCommandBuffer(inheritance);
+				vkCmdSetViewport(cmd->handle, 0, 1, &viewport); //dynamic state doesn't carry into secondaries
+				vkCmdSetScissor(cmd->handle, 0, 1, &scissor);
+				recordFunc(task, cmd->handle);
+				VULKAN_CALL_ERROR(vkEndCommandBuffer(cmd->handle), "failed to end secondary command buffer");
+				secondaryCommandBuffers[task] = cmd->handle;
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> _lock(errorLock);
+				if (!error) error = std::current_exception();
+			}
+		}
+	});
+
+	if (error)
+		std::rethrow_exception(error);
+
+	//join in task order regardless of who finished first
+	vkCmdExecuteCommands(pDevice->GetCurrentFrame()->cmdBuffer->handle, taskCount, secondaryCommandBuffers.data());
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "includes.h"
+#include <functional>
+
+class GraphicsDevice;
+class JobSystem;
+
+//records the contents of the current render pass on the job system workers. every task gets its own secondary command
+//buffer (from the recording thread's pool) and the secondaries are executed in task order, so output is deterministic
+//no matter which thread recorded what
+class ParallelCommandRecorder
+{
+public:
+	typedef std::function<void(uint32_t taskIndex, VkCommandBuffer cmd)> RecordFunction;
+
+	ParallelCommandRecorder(GraphicsDevice* pDevice, JobSystem* pJobs);
+	~ParallelCommandRecorder();
+
+	//call between BeginRenderPass(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) and EndRenderPass.
+	//recordFunc must bind its own pipeline/descriptors, nothing is inherited besides the render pass. viewport/scissor are preset to the swapchain extent
+	void Record(uint32_t taskCount, RecordFunction recordFunc);
+private:
+	GraphicsDevice* pDevice;
+	JobSystem* pJobs;
+
+	std::vector<VkCommandBuffer> secondaryCommandBuffers;
+};
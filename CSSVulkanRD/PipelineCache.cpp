@@ -0,0 +1,167 @@
+#include "PipelineCache.h"
+#include <cstdio>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+PipelineCache::PipelineCache(VkDevice GPU, const VkPhysicalDeviceProperties& gpuProperties)
+{
+	this->GPU = GPU;
+	this->gpuProperties = gpuProperties;
+	cache = VK_NULL_HANDLE;
+
+	createCache(nullptr, 0);
+}
+
+PipelineCache::~PipelineCache()
+{
+	Destroy();
+}
+
+bool PipelineCache::Load(const std::string& path)
+{
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> data(fileSize);
+	file.seekg(0);
+	file.read(data.data(), fileSize);
+	file.close();
+
+	if (!validateHeader(data))
+	{
+		std::cout << "pipeline cache: " << path << " does not match this device/driver, starting cold" << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> guard(lock);
+	if (cache != VK_NULL_HANDLE)
+		vkDestroyPipelineCache(GPU, cache, nullptr);
+	createCache(data.data(), data.size());
+
+	std::cout << "pipeline cache: loaded " << data.size() << " bytes from " << path << std::endl;
+	return true;
+}
+
+bool PipelineCache::Save(const std::string& path)
+{
+	std::vector<char> data;
+	{
+		std::lock_guard<std::mutex> guard(lock);
+
+		size_t dataSize = 0;
+		VULKAN_CALL_ERROR(vkGetPipelineCacheData(GPU, cache, &dataSize, nullptr), "failed to query pipeline cache size");
+		data.resize(dataSize);
+		VULKAN_CALL_ERROR(vkGetPipelineCacheData(GPU, cache, &dataSize, data.data()), "failed to read pipeline cache data");
+		data.resize(dataSize);
+	}
+
+	if (data.empty())
+		return false;
+
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		file.write(data.data(), data.size());
+		if (!file.good())
+			return false;
+	}
+
+#ifdef _WIN32
+	//rename() refuses to overwrite on windows
+	if (!MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+#else
+	if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+VkPipelineCache PipelineCache::GetCache() const
+{
+	return cache;
+}
+
+VkPipelineCache PipelineCache::CreateThreadCache()
+{
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	VkPipelineCache threadCache = VK_NULL_HANDLE;
+	VULKAN_CALL_ERROR(vkCreatePipelineCache(GPU, &cacheInfo, nullptr, &threadCache), "failed to create thread pipeline cache");
+	return threadCache;
+}
+
+void PipelineCache::Merge(VkPipelineCache threadCache)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		VULKAN_CALL_ERROR(vkMergePipelineCaches(GPU, cache, 1, &threadCache), "failed to merge pipeline caches");
+	}
+
+	vkDestroyPipelineCache(GPU, threadCache, nullptr);
+}
+
+size_t PipelineCache::GetDataSize()
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(GPU, cache, &dataSize, nullptr);
+	return dataSize;
+}
+
+void PipelineCache::Destroy()
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (cache != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineCache(GPU, cache, nullptr);
+		cache = VK_NULL_HANDLE;
+	}
+}
+
+bool PipelineCache::validateHeader(const std::vector<char>& data) const
+{
+	//VkPipelineCacheHeaderVersionOne: headerSize, headerVersion, vendorID, deviceID, pipelineCacheUUID
+	const size_t headerSize = 16 + VK_UUID_SIZE;
+	if (data.size() < headerSize)
+		return false;
+
+	uint32_t header[4];
+	memcpy(header, data.data(), sizeof(header));
+
+	if (header[0] < headerSize || header[0] > data.size())
+		return false;
+	if (header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+		return false;
+	if (header[2] != gpuProperties.vendorID || header[3] != gpuProperties.deviceID)
+		return false;
+
+	return memcmp(data.data() + 16, gpuProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::createCache(const void* pInitialData, size_t initialDataSize)
+{
+	VkPipelineCacheCreateInfo cacheInfo{};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = initialDataSize;
+	cacheInfo.pInitialData = pInitialData;
+
+	VULKAN_CALL_ERROR(vkCreatePipelineCache(GPU, &cacheInfo, nullptr, &cache), "failed to create pipeline cache");
+}
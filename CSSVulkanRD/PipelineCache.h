@@ -0,0 +1,34 @@
+#pragma once
+#include "includes.h"
+#include <string>
+
+//device wide VkPipelineCache persisted between runs. the blob is only reused when its header matches
+//this device's vendor, device id and pipelineCacheUUID, anything else starts empty
+class PipelineCache
+{
+public:
+	PipelineCache(VkDevice GPU, const VkPhysicalDeviceProperties& gpuProperties);
+	~PipelineCache();
+
+	bool Load(const std::string& path); //false when the file is missing, truncated or from another device/driver
+	bool Save(const std::string& path); //writes path.tmp then renames over path, a crash never leaves a torn cache
+
+	VkPipelineCache GetCache() const; //internally synchronized, safe to pass to concurrent vkCreate*Pipelines
+
+	//per thread caches for long parallel build passes, folded back into the shared cache when done
+	VkPipelineCache CreateThreadCache();
+	void Merge(VkPipelineCache threadCache); //destroys threadCache
+
+	size_t GetDataSize();
+
+	void Destroy();
+private:
+	VkDevice GPU;
+	VkPhysicalDeviceProperties gpuProperties;
+	VkPipelineCache cache;
+
+	std::mutex lock;
+
+	bool validateHeader(const std::vector<char>& data) const;
+	void createCache(const void* pInitialData, size_t initialDataSize);
+};
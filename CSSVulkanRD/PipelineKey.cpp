@@ -0,0 +1,26 @@
+#include "PipelineKey.h"
+
+void PipelineKey::AddString(const char* pString)
+{
+	size_t length = pString ? strlen(pString) : 0;
+	Add(length);
+	if (length)
+		data.insert(data.end(), pString, pString + length);
+}
+
+size_t PipelineKey::Hash() const
+{
+	//FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (uint8_t byte : data)
+	{
+		hash ^= byte;
+		hash *= 1099511628211ull;
+	}
+	return (size_t)hash;
+}
+
+bool PipelineKey::operator==(const PipelineKey& other) const
+{
+	return data == other.data;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include "includes.h"
+#include <unordered_map>
+#include <type_traits>
+
+//serialized pipeline description. states with equal keys build identical objects, so only the bytes are compared,
+//never the create info pointers. only feed it padding free values
+struct PipelineKey
+{
+	std::vector<uint8_t> data;
+
+	template<typename T>
+	void Add(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "pipeline keys only hold plain data");
+		const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&value);
+		data.insert(data.end(), pBytes, pBytes + sizeof(T));
+	}
+
+	void AddString(const char* pString);
+
+	size_t Hash() const;
+	bool operator==(const PipelineKey& other) const;
+};
+
+//refcounted handle lookup by key, the storage behind the pipeline and layout caches. not synchronized, the owner locks
+template<typename Handle>
+struct KeyedObjectTable
+{
+	struct Entry
+	{
+		PipelineKey key;
+		size_t hash;
+		Handle handle;
+		uint32_t refCount;
+	};
+
+	std::unordered_multimap<size_t, Entry*> entries;
+	std::unordered_map<Handle, Entry*> lookup;
+
+	Handle Find(const PipelineKey& key, size_t hash) //adds a reference
+	{
+		auto range = entries.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second->key == key)
+			{
+				it->second->refCount++;
+				return it->second->handle;
+			}
+		}
+		return VK_NULL_HANDLE;
+	}
+
+	void Insert(const PipelineKey& key, size_t hash, Handle handle)
+	{
+		Entry* pEntry = new Entry();
+		pEntry->key = key;
+		pEntry->hash = hash;
+		pEntry->handle = handle;
+		pEntry->refCount = 1;
+
+		entries.insert({ hash, pEntry });
+		lookup[handle] = pEntry;
+	}
+
+	bool Release(Handle handle) //true when the last reference is gone and the handle should be destroyed
+	{
+		auto it = lookup.find(handle);
+		if (it == lookup.end())
+			return false;
+
+		Entry* pEntry = it->second;
+		if (--pEntry->refCount > 0)
+			return false;
+
+		auto range = entries.equal_range(pEntry->hash);
+		for (auto entry = range.first; entry != range.second; ++entry)
+		{
+			if (entry->second == pEntry)
+			{
+				entries.erase(entry);
+				break;
+			}
+		}
+		lookup.erase(it);
+		delete pEntry;
+
+		return true;
+	}
+
+	std::vector<Handle> Clear()
+	{
+		std::vector<Handle> handles;
+		for (auto& entry : lookup)
+		{
+			handles.push_back(entry.first);
+			delete entry.second;
+		}
+		entries.clear();
+		lookup.clear();
+
+		return handles;
+	}
+
+	uint32_t Size() const
+	{
+		return static_cast<uint32_t>(lookup.size());
+	}
+};
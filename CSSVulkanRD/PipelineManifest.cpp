@@ -0,0 +1,462 @@
+#include "PipelineManifest.h"
+#include "GraphicsDevice.h"
+#include "PipelineState.h"
+#include "Shader.h"
+#include "JobSystem.h"
+#include <chrono>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+static const uint32_t MANIFEST_MAGIC = 0x464D5043; //"CPMF"
+static const uint32_t MANIFEST_VERSION = 2; //2: extended dynamic state flag
+
+//upper bounds for the counts stored in the file, anything above is a corrupt or foreign manifest
+static const uint32_t MAX_MANIFEST_ENTRIES = 65536;
+static const uint32_t MAX_MANIFEST_STAGES = 5; //vertex, tessellation control/evaluation, geometry, fragment
+static const uint32_t MAX_MANIFEST_ATTRIBUTES = 32;
+static const uint32_t MAX_MANIFEST_BINDINGS = 256;
+static const uint32_t MAX_MANIFEST_PUSH_CONSTANT_RANGES = 8;
+
+//counterpart of PipelineKey::Add, fails instead of reading past the end
+struct ManifestReader
+{
+	const uint8_t* pData;
+	const uint8_t* pEnd;
+	bool failed = false;
+
+	template<typename T>
+	T Read()
+	{
+		T value{};
+		if (failed || (size_t)(pEnd - pData) < sizeof(T))
+		{
+			failed = true;
+			return value;
+		}
+		memcpy(&value, pData, sizeof(T));
+		pData += sizeof(T);
+		return value;
+	}
+
+	//element count followed by that many elements of at least elementSize bytes
+	uint32_t ReadCount(size_t elementSize, uint32_t maxCount)
+	{
+		uint32_t count = Read<uint32_t>();
+		if (failed || count > maxCount || (size_t)(pEnd - pData) / elementSize < count)
+		{
+			failed = true;
+			return 0;
+		}
+		return count;
+	}
+
+	std::string ReadString()
+	{
+		size_t length = Read<size_t>();
+		if (failed || (size_t)(pEnd - pData) < length)
+		{
+			failed = true;
+			return std::string();
+		}
+		std::string value(reinterpret_cast<const char*>(pData), length);
+		pData += length;
+		return value;
+	}
+};
+
+PipelineManifest::PipelineManifest(GraphicsDevice* pDevice)
+{
+	this->pDevice = pDevice;
+}
+
+PipelineManifest::~PipelineManifest()
+{
+}
+
+void PipelineManifest::Record(const PipelineState* pState)
+{
+	if (pState->renderPass != pDevice->GetRenderPass() || !pState->pShader)
+		return;
+	if (pState->blendState.blendState.attachmentCount > 1) //BlendState only carries one attachment
+		return;
+	if (pState->pBindless) //the warmed up layout wouldn't include the table
+		return;
+
+	PipelineKey entry;
+
+	entry.Add(static_cast<uint32_t>(pState->shaderStages.size()));
+	for (const auto& stage : pState->shaderStages)
+	{
+		auto pResource = pState->pShader->GetShader(stage.stage);
+		if (!pResource || pResource->path.empty())
+			return; //not loaded from a file, can't be recreated
+
+		entry.Add(stage.stage);
+		entry.AddString(pResource->path.c_str());
+		entry.AddString(stage.pName);
+	}
+
+	entry.Add(pState->vertexInputData.vertexBindingDesc);
+	entry.Add(static_cast<uint32_t>(pState->vertexInputData.vertexInputAttributeDescriptions.size()));
+	for (const auto& attribute : pState->vertexInputData.vertexInputAttributeDescriptions)
+		entry.Add(attribute);
+
+	entry.Add(pState->inputAssembly.topology);
+	entry.Add(pState->inputAssembly.primitiveRestartEnable);
+
+	const auto& raster = pState->rasterizerState;
+	entry.Add(raster.depthClampEnable);
+	entry.Add(raster.rasterizerDiscardEnable);
+	entry.Add(raster.polygonMode);
+	entry.Add(raster.cullMode);
+	entry.Add(raster.frontFace);
+	entry.Add(raster.depthBiasEnable);
+	entry.Add(raster.depthBiasConstantFactor);
+	entry.Add(raster.depthBiasClamp);
+	entry.Add(raster.depthBiasSlopeFactor);
+	entry.Add(raster.lineWidth);
+
+	const auto& multisample = pState->multisampleState;
+	entry.Add(multisample.rasterizationSamples);
+	entry.Add(multisample.sampleShadingEnable);
+	entry.Add(multisample.minSampleShading);
+	entry.Add(multisample.alphaToCoverageEnable);
+	entry.Add(multisample.alphaToOneEnable);
+
+	const auto& blend = pState->blendState;
+	entry.Add(blend.blendState.logicOpEnable);
+	entry.Add(blend.blendState.logicOp);
+	entry.Add(blend.blendState.attachmentCount);
+	entry.Add(blend.colorBlendAttachment);
+	entry.Add(blend.blendState.blendConstants);
+
+	entry.Add(static_cast<uint32_t>(pState->descriptorSetLayoutBindings.size()));
+	for (const auto& binding : pState->descriptorSetLayoutBindings)
+	{
+		if (binding.pImmutableSamplers)
+			return; //sampler handles don't survive a restart
+
+		entry.Add(binding.binding);
+		entry.Add(binding.descriptorType);
+		entry.Add(binding.descriptorCount);
+		entry.Add(binding.stageFlags);
+	}
+
+	entry.Add(static_cast<uint32_t>(pState->pushConstantRanges.size()));
+	for (const auto& range : pState->pushConstantRanges)
+		entry.Add(range);
+
+	entry.Add(pState->extendedDynamicState);
+
+	std::lock_guard<std::mutex> _lock(lock);
+
+	if (recordedHashes.insert(entry.Hash()).second)
+		entries.push_back(std::move(entry.data));
+}
+
+bool PipelineManifest::Load(const std::string& path)
+{
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<uint8_t> data(fileSize);
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(data.data()), fileSize);
+	file.close();
+
+	ManifestReader reader{ data.data(), data.data() + data.size() };
+	uint32_t magic = reader.Read<uint32_t>();
+	uint32_t version = reader.Read<uint32_t>();
+	uint32_t count = reader.ReadCount(sizeof(uint32_t), MAX_MANIFEST_ENTRIES);
+
+	if (reader.failed || magic != MANIFEST_MAGIC || version != MANIFEST_VERSION)
+	{
+		std::cout << "pipeline manifest: " << path << " is not a version " << MANIFEST_VERSION << " manifest, ignoring it" << std::endl;
+		return false;
+	}
+
+	std::vector<PipelineKey> loaded(count);
+	for (PipelineKey& entry : loaded)
+	{
+		uint32_t size = reader.Read<uint32_t>();
+		if (reader.failed || (size_t)(reader.pEnd - reader.pData) < size)
+		{
+			std::cout << "pipeline manifest: " << path << " is truncated, ignoring it" << std::endl;
+			return false;
+		}
+
+		entry.data.assign(reader.pData, reader.pData + size);
+		reader.pData += size;
+	}
+
+	std::lock_guard<std::mutex> _lock(lock);
+
+	for (PipelineKey& entry : loaded)
+	{
+		if (recordedHashes.insert(entry.Hash()).second)
+			entries.push_back(std::move(entry.data));
+	}
+
+	return true;
+}
+
+bool PipelineManifest::Save(const std::string& path)
+{
+	PipelineKey file;
+	{
+		std::lock_guard<std::mutex> _lock(lock);
+
+		file.Add(MANIFEST_MAGIC);
+		file.Add(MANIFEST_VERSION);
+		file.Add(static_cast<uint32_t>(entries.size()));
+		for (const auto& entry : entries)
+		{
+			file.Add(static_cast<uint32_t>(entry.size()));
+			file.data.insert(file.data.end(), entry.begin(), entry.end());
+		}
+	}
+
+	//same temp file + rename as the pipeline cache
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+
+		out.write(reinterpret_cast<const char*>(file.data.data()), file.data.size());
+		if (!out.good())
+			return false;
+	}
+
+#ifdef _WIN32
+	if (!MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+#else
+	if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+#endif
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+uint32_t PipelineManifest::WarmUp(JobSystem* pJobs)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::vector<uint8_t>> pending;
+	{
+		std::lock_guard<std::mutex> _lock(lock);
+		pending = entries;
+	}
+
+	if (pending.empty())
+		return 0;
+
+	//shader loads and state setup on this thread, the compiles fan out
+	std::vector<PipelineState*> states;
+	for (const auto& entry : pending)
+	{
+		bool malformed = false;
+		PipelineState* pState = createState(entry, malformed);
+		if (pState)
+			states.push_back(pState);
+
+		if (malformed)
+		{
+			//the file is corrupt, none of it can be trusted. it's rewritten from this session's builds at shutdown
+			std::cout << "pipeline manifest: malformed entry, dropping the manifest" << std::endl;
+			for (PipelineState* pCreated : states)
+			{
+				pCreated->Destroy();
+				delete pCreated;
+			}
+
+			std::lock_guard<std::mutex> _lock(lock);
+			entries.clear();
+			recordedHashes.clear();
+			return 0;
+		}
+	}
+
+	std::atomic<uint32_t> built = 0;
+	pJobs->ParallelFor(static_cast<uint32_t>(states.size()), 1, [&](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			try
+			{
+				states[i]->Build();
+				built++;
+			}
+			catch (const std::exception& e)
+			{
+				std::cout << "pipeline manifest: warm-up build failed: " << e.what() << std::endl;
+			}
+		}
+	});
+
+	warmStates.insert(warmStates.end(), states.begin(), states.end());
+
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << "pipeline warm-up: " << built.load() << "/" << pending.size() << " pipelines in " << elapsedMs << "ms across "
+		<< pJobs->GetWorkerCount() << " workers" << std::endl;
+
+	return built.load();
+}
+
+uint32_t PipelineManifest::GetEntryCount()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+	return static_cast<uint32_t>(entries.size());
+}
+
+void PipelineManifest::Destroy()
+{
+	for (PipelineState* pState : warmStates)
+	{
+		pState->Destroy();
+		delete pState;
+	}
+	warmStates.clear();
+
+	for (auto& shader : warmShaders)
+	{
+		shader.second->Destroy();
+		delete shader.second;
+	}
+	warmShaders.clear();
+}
+
+PipelineState* PipelineManifest::createState(const std::vector<uint8_t>& entry, bool& malformed)
+{
+	ManifestReader reader{ entry.data(), entry.data() + entry.size() };
+
+	PipelineState* pState = new PipelineState(pDevice, 0); //no descriptor sets, nothing ever draws with it
+
+	try
+	{
+		std::vector<ShaderStageRecord> stages(reader.ReadCount(sizeof(VkShaderStageFlagBits) + 2 * sizeof(size_t), MAX_MANIFEST_STAGES));
+		for (auto& stage : stages)
+		{
+			stage.stage = reader.Read<VkShaderStageFlagBits>();
+			stage.path = reader.ReadString();
+			stage.entrypoint = reader.ReadString();
+		}
+		if (!reader.failed)
+			pState->SetShader(getShader(stages));
+
+		VertexInputData vertexInput;
+		vertexInput.vertexBindingDesc = reader.Read<VkVertexInputBindingDescription>();
+		uint32_t attributeCount = reader.ReadCount(sizeof(VkVertexInputAttributeDescription), MAX_MANIFEST_ATTRIBUTES);
+		for (uint32_t i = 0; i < attributeCount && !reader.failed; ++i)
+			vertexInput.vertexInputAttributeDescriptions.push_back(reader.Read<VkVertexInputAttributeDescription>());
+		pState->SetVertexInput(vertexInput);
+
+		pState->SetPrimitiveTopology(reader.Read<VkPrimitiveTopology>());
+		pState->SetPrimitiveRestartEnable(reader.Read<VkBool32>());
+
+		VkPipelineRasterizationStateCreateInfo raster{};
+		raster.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		raster.depthClampEnable = reader.Read<VkBool32>();
+		raster.rasterizerDiscardEnable = reader.Read<VkBool32>();
+		raster.polygonMode = reader.Read<VkPolygonMode>();
+		raster.cullMode = reader.Read<VkCullModeFlags>();
+		raster.frontFace = reader.Read<VkFrontFace>();
+		raster.depthBiasEnable = reader.Read<VkBool32>();
+		raster.depthBiasConstantFactor = reader.Read<float>();
+		raster.depthBiasClamp = reader.Read<float>();
+		raster.depthBiasSlopeFactor = reader.Read<float>();
+		raster.lineWidth = reader.Read<float>();
+		pState->SetRasterizerState(raster);
+
+		VkPipelineMultisampleStateCreateInfo multisample{};
+		multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisample.rasterizationSamples = reader.Read<VkSampleCountFlagBits>();
+		multisample.sampleShadingEnable = reader.Read<VkBool32>();
+		multisample.minSampleShading = reader.Read<float>();
+		multisample.alphaToCoverageEnable = reader.Read<VkBool32>();
+		multisample.alphaToOneEnable = reader.Read<VkBool32>();
+		pState->SetMultisamplingState(multisample);
+
+		BlendState blend{};
+		blend.blendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		blend.blendState.logicOpEnable = reader.Read<VkBool32>();
+		blend.blendState.logicOp = reader.Read<VkLogicOp>();
+		blend.blendState.attachmentCount = reader.Read<uint32_t>();
+		blend.colorBlendAttachment = reader.Read<VkPipelineColorBlendAttachmentState>();
+		auto constants = reader.Read<std::array<float, 4>>();
+		memcpy(blend.blendState.blendConstants, constants.data(), sizeof(blend.blendState.blendConstants));
+		pState->SetBlendState(blend);
+
+		uint32_t bindingCount = reader.ReadCount(3 * sizeof(uint32_t) + sizeof(VkShaderStageFlags), MAX_MANIFEST_BINDINGS);
+		for (uint32_t i = 0; i < bindingCount && !reader.failed; ++i)
+		{
+			VkDescriptorSetLayoutBinding binding{};
+			binding.binding = reader.Read<uint32_t>();
+			binding.descriptorType = reader.Read<VkDescriptorType>();
+			binding.descriptorCount = reader.Read<uint32_t>();
+			binding.stageFlags = reader.Read<VkShaderStageFlags>();
+			pState->RegisterDescriptorSetLayoutBinding(binding);
+		}
+
+		uint32_t rangeCount = reader.ReadCount(sizeof(VkPushConstantRange), MAX_MANIFEST_PUSH_CONSTANT_RANGES);
+		for (uint32_t i = 0; i < rangeCount && !reader.failed; ++i)
+			pState->pushConstantRanges.push_back(reader.Read<VkPushConstantRange>());
+
+		pState->SetExtendedDynamicState(reader.Read<bool>());
+
+		pState->SetRenderPass(pDevice->GetRenderPass());
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "pipeline manifest: skipping entry: " << e.what() << std::endl; //missing shader, the entry itself is fine
+		delete pState;
+		return nullptr;
+	}
+
+	if (reader.failed)
+	{
+		malformed = true;
+		delete pState;
+		return nullptr;
+	}
+
+	return pState;
+}
+
+Shader* PipelineManifest::getShader(const std::vector<ShaderStageRecord>& stages)
+{
+	std::string key;
+	for (const auto& stage : stages)
+		key += std::to_string(stage.stage) + "|" + stage.path + "|" + stage.entrypoint + "|";
+
+	auto it = warmShaders.find(key);
+	if (it != warmShaders.end())
+		return it->second;
+
+	Shader* pShader = new Shader(pDevice->GetGPU());
+	try
+	{
+		for (const auto& stage : stages)
+		{
+			entrypoints.push_back(stage.entrypoint);
+			pShader->LoadShader(stage.path.c_str(), entrypoints.back().c_str(), stage.stage); //throws when the file is gone
+		}
+	}
+	catch (...)
+	{
+		pShader->Destroy();
+		delete pShader;
+		throw;
+	}
+
+	warmShaders[key] = pShader;
+	return pShader;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "includes.h"
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_set>
+
+class GraphicsDevice;
+class PipelineState;
+class Shader;
+class JobSystem;
+
+//every PipelineState built in a session, in a compact binary file. the next launch rebuilds them all in parallel
+//up front so first use finds the pipeline in the PipelineStateCache instead of compiling mid frame.
+//only states targeting the device render pass are recorded, that's the one render pass that can be recreated
+class PipelineManifest
+{
+public:
+	PipelineManifest(GraphicsDevice* pDevice);
+	~PipelineManifest();
+
+	void Record(const PipelineState* pState); //called by PipelineState on every build, duplicates are ignored
+
+	bool Load(const std::string& path);
+	bool Save(const std::string& path);
+
+	uint32_t WarmUp(JobSystem* pJobs); //builds every loaded entry across the workers, returns how many were created
+
+	uint32_t GetEntryCount();
+
+	void Destroy(); //releases the warmed states and their shaders
+private:
+	GraphicsDevice* pDevice;
+
+	std::mutex lock;
+	std::vector<std::vector<uint8_t>> entries;
+	std::unordered_set<size_t> recordedHashes;
+
+	std::vector<PipelineState*> warmStates; //hold references so the cache keeps the pipelines alive
+	std::map<std::string, Shader*> warmShaders;
+	std::deque<std::string> entrypoints; //ShaderResource only keeps the pointer
+
+	struct ShaderStageRecord
+	{
+		VkShaderStageFlagBits stage;
+		std::string path;
+		std::string entrypoint;
+	};
+
+	PipelineState* createState(const std::vector<uint8_t>& entry, bool& malformed); //nullptr when the entry is malformed or a shader is missing
+	Shader* getShader(const std::vector<ShaderStageRecord>& stages); //one Shader per distinct stage set, shared between entries
+};
@@ -1,16 +1,23 @@
 #include "PipelineState.h"
 #include "Shader.h"
-
-PipelineState::PipelineState(VkDevice gpu, uint32_t numFramebuffers)
+#include "GraphicsDevice.h"
+#include "DeferredDeletionQueue.h"
+#include "JobSystem.h"
+#include "PipelineManifest.h"
+#include "DescriptorLayoutCache.h"
+#include "DescriptorAllocator.h"
+#include "DescriptorSetWriter.h"
+#include "BindlessResourceTable.h"
+
+PipelineState::PipelineState(GraphicsDevice* pDevice, uint32_t numFramebuffers)
 {
-	GPU = gpu;
+	this->pDevice = pDevice;
+	GPU = pDevice->GetGPU();
 
 	inputAssembly = {};
 	vertexInputInfo = {};
 	pipelineInfo = {};
-	pipelineLayoutInfo = {};
 	//colorBlendState = {};
-	descriptorSetLayoutCreateInfo = {};
 
 	this->numFramebuffers = numFramebuffers;
 	descriptorSets.resize(numFramebuffers);
@@ -20,10 +27,28 @@ PipelineState::PipelineState(VkDevice gpu, uint32_t numFramebuffers)
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	rasterizerState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 	multisampleState.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	//colorBlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	descriptorSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+
+	extendedDynamicState = false;
+	updateDynamicStates();
+	dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+
+	pipeline = VK_NULL_HANDLE;
+	libraryParts = {};
+	pipelineLayout = VK_NULL_HANDLE;
+	descriptorSetLayout = VK_NULL_HANDLE;
+	renderPass = VK_NULL_HANDLE;
+	pShader = nullptr;
+	pDescriptorAllocator = pDevice->GetDescriptorAllocator().get();
+	pDescriptorWriter = nullptr;
+	pBindless = nullptr;
+	hash = 0;
+	ready.store(false);
+	hitchRecorded.store(false);
+	pFallback = nullptr;
+	pBuildJobs = nullptr;
 
 	dirty = false;
 }
@@ -106,12 +131,20 @@ void PipelineState::SetMultisamplingState(VkPipelineMultisampleStateCreateInfo m
 void PipelineState::SetBlendState(BlendState blendState)
 {
 	this->blendState = blendState;
+	if (this->blendState.blendState.attachmentCount == 1)
+		this->blendState.blendState.pAttachments = &this->blendState.colorBlendAttachment; //the caller's pointer doesn't outlive the call
 	dirty = true;
 }
 
 void PipelineState::SetPushConstantRange(VkPushConstantRange range)
 {
-	throw std::runtime_error("not impl");
+	uint32_t maxSize = std::min(pDevice->GetDeviceProperties().limits.maxPushConstantsSize, MAX_PUSH_CONSTANT_SIZE);
+	if (range.size == 0 || range.offset % 4 != 0 || range.size % 4 != 0 || range.offset + range.size > maxSize)
+		throw std::runtime_error("push constant range must be 4 byte aligned and within " + std::to_string(maxSize) + " bytes");
+	if (range.stageFlags == 0)
+		throw std::runtime_error("push constant range without shader stages");
+
+	pushConstantRanges.push_back(range); //merged per stage when the layout is built
 	dirty = true;
 }
 
@@ -139,9 +172,55 @@ void PipelineState::SetRenderPass(VkRenderPass pass)
 	dirty = true;
 }
 
+void PipelineState::SetExtendedDynamicState(bool enable)
+{
+	extendedDynamicState = enable;
+	dirty = true;
+}
+
+bool PipelineState::IsDynamic(VkDynamicState state) const
+{
+	return std::find(dynamicStates.begin(), dynamicStates.end(), state) != dynamicStates.end();
+}
+
+void PipelineState::updateDynamicStates()
+{
+	//pipelines survive swapchain resizes
+	dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+#ifdef VK_EXT_extended_dynamic_state
+	if (extendedDynamicState && pDevice->SupportsExtendedDynamicState())
+	{
+		dynamicStates.push_back(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+		dynamicStates.push_back(VK_DYNAMIC_STATE_FRONT_FACE_EXT);
+		dynamicStates.push_back(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT);
+		dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT);
+		dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT);
+		dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT);
+	}
+#endif
+}
+
+static uint32_t topologyClass(VkPrimitiveTopology topology)
+{
+	switch (topology)
+	{
+		case VK_PRIMITIVE_TOPOLOGY_POINT_LIST: return 0;
+		case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+		case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+		case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+		case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY: return 1;
+		case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST: return 3;
+		default: return 2; //triangles
+	}
+}
+
 VkDescriptorSet PipelineState::GetDescriptorSet(uint32_t index)
 {
-	assert(index <= descriptorSets.size());
+	assert(index < descriptorSets.size());
+
+	if (pDescriptorWriter)
+		pDescriptorWriter->Flush(descriptorSets[index]);
 
 	return descriptorSets[index];
 }
@@ -152,84 +231,169 @@ void PipelineState::RegisterDescriptorSetLayoutBinding(VkDescriptorSetLayoutBind
 	dirty = true;
 }
 
-void PipelineState::SetDescriptorPool(VkDescriptorPool pool)
+void PipelineState::SetDescriptorAllocator(DescriptorAllocator* pAllocator)
 {
-	descriptorPool = pool;
+	pDescriptorAllocator = pAllocator;
 }
 
-void PipelineState::UpdateUniformBufferDescriptor(uint32_t descriptorSetIndex, uint32_t descriptorBindingIndex, VkBuffer gpuBuffer, VkDeviceSize bindOffset, VkDeviceSize bindSize)
+void PipelineState::SetBindlessTable(BindlessResourceTable* pTable)
 {
-	assert(descriptorSetIndex <= descriptorSets.size());
+	pBindless = pTable;
+	dirty = true;
+}
 
+uint32_t PipelineState::GetDescriptorSetIndex() const
+{
+	return pBindless ? 1 : 0;
+}
 
-	VkDescriptorBufferInfo bufferInfo{};
-	bufferInfo.buffer = gpuBuffer;
-	bufferInfo.offset = bindOffset;
-	bufferInfo.range = bindSize;
+void PipelineState::UpdateUniformBufferDescriptor(uint32_t descriptorSetIndex, uint32_t descriptorBindingIndex, VkBuffer gpuBuffer, VkDeviceSize bindOffset, VkDeviceSize bindSize)
+{
+	assert(descriptorSetIndex < descriptorSets.size());
 
-	VkWriteDescriptorSet write{};
-	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	write.dstSet = descriptorSets[descriptorSetIndex];
-	write.dstBinding = descriptorBindingIndex;
-	write.dstArrayElement = 0; //what the fuck is this
-	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	write.descriptorCount = 1;
-	write.pBufferInfo = &bufferInfo;
+	if (!pDescriptorWriter)
+		throw std::runtime_error("descriptor sets not allocated, call Build first");
 
-	vkUpdateDescriptorSets(GPU, 1, &write, 0, nullptr);
+	pDescriptorWriter->SetBuffer(descriptorSets[descriptorSetIndex], descriptorBindingIndex, gpuBuffer, bindOffset, bindSize);
 }
 
 void PipelineState::Build()
 {
+	waitForBuild(); //an async build still reads our create info
+
 	if (dirty)
 	{
-		pipelineInfo.stageCount = shaderStages.size();
-		pipelineInfo.pStages = shaderStages.data();
-		
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputData.vertexInputAttributeDescriptions.size());
-		vertexInputInfo.pVertexBindingDescriptions = &vertexInputData.vertexBindingDesc;
-		vertexInputInfo.pVertexAttributeDescriptions = vertexInputData.vertexInputAttributeDescriptions.data();
-
-		pipelineInfo.pVertexInputState = &vertexInputInfo;
-		pipelineInfo.pInputAssemblyState = &inputAssembly;
-
-		viewportState.viewportCount = 1; // 1 viewport supported at this time
-		viewportState.pViewports = &viewport;
-		viewportState.scissorCount = 1; // 1 scissor supported at this time
-		viewportState.pScissors = &scissor;
-
-		pipelineInfo.pViewportState = &viewportState;
-		pipelineInfo.pRasterizationState = &rasterizerState;
-		pipelineInfo.pMultisampleState = &multisampleState;
-		pipelineInfo.pColorBlendState = &blendState.blendState;
-
-		createDescriptorSetLayout(); //at this point build the descriptor set layout from descriptor set bindings
-		createDescriptorSets();
-
-		if (pushConstantRanges.size() > 0)
+		PipelineKey key = prepareBuild();
+		pipeline = compilePipeline(key);
+		ready.store(true, std::memory_order_release);
+		dirty = false;
+	}
+}
+
+JobHandle PipelineState::BuildAsync(JobSystem* pJobs)
+{
+	waitForBuild();
+
+	if (!dirty)
+		return nullptr;
+
+	//layouts and descriptor sets are cheap, only the pipeline compile goes to a worker
+	PipelineKey key = prepareBuild();
+	pDevice->GetPipelineStateCache()->RecordAsyncBuild();
+
+	buildError = nullptr;
+	hitchRecorded.store(false);
+	pBuildJobs = pJobs;
+	buildJob = pJobs->Schedule([this, key]()
+	{
+		try
 		{
-			pipelineLayoutInfo.pushConstantRangeCount = pushConstantRanges.size();
-			pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+			pipeline = compilePipeline(key);
 		}
-		else
+		catch (...)
 		{
-			pipelineLayoutInfo.pushConstantRangeCount = 0;
-			pipelineLayoutInfo.pPushConstantRanges = nullptr;
+			buildError = std::current_exception();
 		}
+		ready.store(true, std::memory_order_release);
+	});
 
+	dirty = false;
+	return buildJob;
+}
 
-		pipelineLayoutInfo.setLayoutCount = 1; //currently 1 descriptor set supported
-		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-		VULKAN_CALL_ERROR(vkCreatePipelineLayout(GPU, &pipelineLayoutInfo, nullptr, &pipelineLayout), "failed to create graphics pipeline layout");
+bool PipelineState::IsReady() const
+{
+	return ready.load(std::memory_order_acquire);
+}
 
-		pipelineInfo.layout = pipelineLayout;
-		pipelineInfo.renderPass = renderPass;
-		pipelineInfo.subpass = 0; //subpasses not yet supported
-		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+void PipelineState::SetFallback(PipelineState* pFallback)
+{
+	this->pFallback = pFallback;
+}
 
-		VULKAN_CALL_ERROR(vkCreateGraphicsPipelines(GPU, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline), "failed to create graphics pipeline");
-		dirty = false;
+PipelineState* PipelineState::Resolve()
+{
+	if (ready.load(std::memory_order_acquire))
+	{
+		if (buildError)
+			std::rethrow_exception(buildError);
+		return this;
+	}
+
+	//drawing with this state now would have stalled on the compile
+	auto cache = pDevice->GetPipelineStateCache();
+	if (!hitchRecorded.exchange(true))
+		cache->RecordAvoidedHitch();
+
+	if (pFallback && pFallback->IsReady())
+	{
+		cache->RecordFallbackDraw();
+		return pFallback;
+	}
+
+	cache->RecordSkippedDraw();
+	return nullptr;
+}
+
+PipelineKey PipelineState::prepareBuild()
+{
+	pipelineInfo.stageCount = shaderStages.size();
+	pipelineInfo.pStages = shaderStages.data();
+	
+	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputData.vertexInputAttributeDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = &vertexInputData.vertexBindingDesc;
+	vertexInputInfo.pVertexAttributeDescriptions = vertexInputData.vertexInputAttributeDescriptions.data();
+
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+
+	viewportState.viewportCount = 1; // 1 viewport supported at this time
+	viewportState.pViewports = &viewport;
+	viewportState.scissorCount = 1; // 1 scissor supported at this time
+	viewportState.pScissors = &scissor;
+
+	pipelineInfo.pViewportState = &viewportState; //counts only, the values come from vkCmdSetViewport/vkCmdSetScissor
+
+	updateDynamicStates();
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+	pipelineInfo.pDynamicState = &dynamicState;
+	pipelineInfo.pRasterizationState = &rasterizerState;
+	pipelineInfo.pMultisampleState = &multisampleState;
+	pipelineInfo.pColorBlendState = &blendState.blendState;
+
+	releaseCachedObjects(); //rebuilding, drop our references to the previous state
+
+	createDescriptorSetLayout(); //at this point build the descriptor set layout from descriptor set bindings
+	createDescriptorSets();
+
+	//compatible interfaces share one layout, so descriptor sets stay bound across pipeline switches
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	if (pBindless) setLayouts.push_back(pBindless->GetDescriptorSetLayout()); //set 0, bound once per frame
+	setLayouts.push_back(descriptorSetLayout);
+	pipelineLayout = pDevice->GetDescriptorLayoutCache()->AcquirePipelineLayout(setLayouts, pushConstantRanges);
+
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.renderPass = renderPass;
+	pipelineInfo.subpass = 0; //subpasses not yet supported
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	ready.store(false);
+
+	pDevice->GetPipelineManifest()->Record(this);
+
+	PipelineKey key = buildKey();
+	hash = key.Hash();
+	return key;
+}
+
+void PipelineState::waitForBuild()
+{
+	if (buildJob)
+	{
+		pBuildJobs->Wait(buildJob);
+		buildJob = nullptr;
 	}
 }
 
@@ -245,22 +409,306 @@ VkPipelineLayout PipelineState::GetPipelineLayout() const
 
 void PipelineState::createDescriptorSetLayout()
 {
-	descriptorSetLayoutCreateInfo.bindingCount = descriptorSetLayoutBindings.size();
-	descriptorSetLayoutCreateInfo.pBindings = descriptorSetLayoutBindings.data();
-	VULKAN_CALL_ERROR(vkCreateDescriptorSetLayout(GPU, &descriptorSetLayoutCreateInfo, nullptr, &descriptorSetLayout), "failed to create descriptor set layout");
+	descriptorSetLayout = pDevice->GetDescriptorLayoutCache()->AcquireDescriptorSetLayout(descriptorSetLayoutBindings);
 }
 
 void PipelineState::createDescriptorSets()
 {
-	std::vector<VkDescriptorSetLayout> layouts(numFramebuffers, descriptorSetLayout);
+	if (!pDescriptorAllocator || numFramebuffers == 0)
+		return; //layout only, e.g. pipeline warm-up
+
+	pDescriptorAllocator->Allocate(descriptorSetLayout, numFramebuffers, descriptorSets.data());
+	pDescriptorWriter = new DescriptorSetWriter(GPU, descriptorSetLayout, DescriptorLayoutCache::NormalizeBindings(descriptorSetLayoutBindings));
+}
+
+void PipelineState::Destroy()
+{
+	waitForBuild();
+	releaseCachedObjects();
+	ready.store(false);
+	dirty = true;
+}
+
+size_t PipelineState::GetHash() const
+{
+	return hash;
+}
+
+PipelineKey PipelineState::buildKey() const
+{
+	PipelineKey key;
+
+	//shader modules by code, two loads of the same SPIR-V are the same pipeline
+	key.Add(shaderStages.size());
+	for (const auto& stage : shaderStages)
+		addShaderStage(key, stage);
+
+	addVertexInputState(key);
+	addRasterizationState(key);
+	addMultisampleState(key);
+	addBlendState(key);
+	addDynamicState(key);
+
+	//layouts are deduplicated by the cache, so equal handles mean equal layouts
+	key.Add(pipelineLayout);
+	key.Add(renderPass);
+	key.Add(pipelineInfo.subpass);
+
+	return key;
+}
+
+void PipelineState::addShaderStage(PipelineKey& key, const VkPipelineShaderStageCreateInfo& stage) const
+{
+	key.Add(stage.stage);
+	key.Add(pShader->GetShader(stage.stage)->codeHash);
+	key.AddString(stage.pName);
+}
+
+void PipelineState::addVertexInputState(PipelineKey& key) const
+{
+	key.Add(vertexInputData.vertexBindingDesc);
+	key.Add(vertexInputData.vertexInputAttributeDescriptions.size());
+	for (const auto& attribute : vertexInputData.vertexInputAttributeDescriptions)
+		key.Add(attribute);
+
+#ifdef VK_EXT_extended_dynamic_state
+	if (IsDynamic(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT))
+		key.Add(topologyClass(inputAssembly.topology)); //only the class is baked in
+	else
+#endif
+		key.Add(inputAssembly.topology);
+	key.Add(inputAssembly.primitiveRestartEnable);
+}
+
+void PipelineState::addRasterizationState(PipelineKey& key) const
+{
+	key.Add(rasterizerState.depthClampEnable);
+	key.Add(rasterizerState.rasterizerDiscardEnable);
+	key.Add(rasterizerState.polygonMode);
+#ifdef VK_EXT_extended_dynamic_state
+	if (!IsDynamic(VK_DYNAMIC_STATE_CULL_MODE_EXT))
+		key.Add(rasterizerState.cullMode);
+	if (!IsDynamic(VK_DYNAMIC_STATE_FRONT_FACE_EXT))
+		key.Add(rasterizerState.frontFace);
+#else
+	key.Add(rasterizerState.cullMode);
+	key.Add(rasterizerState.frontFace);
+#endif
+	key.Add(rasterizerState.depthBiasEnable);
+	key.Add(rasterizerState.depthBiasConstantFactor);
+	key.Add(rasterizerState.depthBiasClamp);
+	key.Add(rasterizerState.depthBiasSlopeFactor);
+	key.Add(rasterizerState.lineWidth);
+}
+
+void PipelineState::addMultisampleState(PipelineKey& key) const
+{
+	key.Add(multisampleState.rasterizationSamples);
+	key.Add(multisampleState.sampleShadingEnable);
+	key.Add(multisampleState.minSampleShading);
+	key.Add(multisampleState.alphaToCoverageEnable);
+	key.Add(multisampleState.alphaToOneEnable);
+}
+
+void PipelineState::addBlendState(PipelineKey& key) const
+{
+	const VkPipelineColorBlendStateCreateInfo& blend = blendState.blendState;
+	key.Add(blend.logicOpEnable);
+	key.Add(blend.logicOp);
+	key.Add(blend.attachmentCount);
+	for (uint32_t i = 0; i < blend.attachmentCount; ++i)
+		key.Add(blend.pAttachments[i]);
+	key.Add(blend.blendConstants);
+}
+
+void PipelineState::addDynamicState(PipelineKey& key) const
+{
+	key.Add(dynamicStates.size());
+	for (VkDynamicState state : dynamicStates)
+		key.Add(state);
+}
+
+VkPipeline PipelineState::compilePipeline(const PipelineKey& key)
+{
+	auto cache = pDevice->GetPipelineStateCache();
+
+#ifdef VK_EXT_graphics_pipeline_library
+	if (pDevice->SupportsPipelineLibrary())
+		return linkPipelineLibrary(cache.get());
+#endif
+
+	return cache->AcquirePipeline(key, pipelineInfo);
+}
+
+#ifdef VK_EXT_graphics_pipeline_library
+VkPipeline PipelineState::linkPipelineLibrary(PipelineStateCache* pCache)
+{
+	//each part is keyed on only the state it consumes, so a new fragment shader or blend state
+	//reuses the other three parts and only pays for its own part plus a fast link
+	const VkPipelineShaderStageCreateInfo* pVertexStage = nullptr;
+	const VkPipelineShaderStageCreateInfo* pFragmentStage = nullptr;
+	for (const auto& stage : shaderStages)
+	{
+		if (stage.stage == VK_SHADER_STAGE_VERTEX_BIT) pVertexStage = &stage;
+		if (stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT) pFragmentStage = &stage;
+	}
+
+	std::array<VkPipeline, 4> parts = {};
+
+	{
+		PipelineKey key;
+		key.Add(VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT);
+		addVertexInputState(key);
+		addDynamicState(key);
+
+		VkGraphicsPipelineCreateInfo partInfo{};
+		partInfo.pVertexInputState = pipelineInfo.pVertexInputState;
+		partInfo.pInputAssemblyState = pipelineInfo.pInputAssemblyState;
+		partInfo.pDynamicState = pipelineInfo.pDynamicState; //topology
+		parts[0] = acquireLibraryPart(pCache, VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT, key, partInfo);
+	}
+	{
+		PipelineKey key;
+		key.Add(VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT);
+		if (pVertexStage) addShaderStage(key, *pVertexStage);
+		addRasterizationState(key);
+		addDynamicState(key);
+		key.Add(pipelineLayout);
+		key.Add(renderPass);
+		key.Add(pipelineInfo.subpass);
+
+		VkGraphicsPipelineCreateInfo partInfo{};
+		partInfo.stageCount = pVertexStage ? 1 : 0;
+		partInfo.pStages = pVertexStage;
+		partInfo.pViewportState = pipelineInfo.pViewportState;
+		partInfo.pRasterizationState = pipelineInfo.pRasterizationState;
+		partInfo.pDynamicState = pipelineInfo.pDynamicState;
+		partInfo.layout = pipelineLayout;
+		partInfo.renderPass = renderPass;
+		partInfo.subpass = pipelineInfo.subpass;
+		parts[1] = acquireLibraryPart(pCache, VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT, key, partInfo);
+	}
+	{
+		PipelineKey key;
+		key.Add(VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT);
+		if (pFragmentStage) addShaderStage(key, *pFragmentStage);
+		addMultisampleState(key);
+		addDynamicState(key);
+		key.Add(pipelineLayout);
+		key.Add(renderPass);
+		key.Add(pipelineInfo.subpass);
+
+		VkGraphicsPipelineCreateInfo partInfo{};
+		partInfo.stageCount = pFragmentStage ? 1 : 0;
+		partInfo.pStages = pFragmentStage;
+		partInfo.pMultisampleState = pipelineInfo.pMultisampleState;
+		partInfo.pDynamicState = pipelineInfo.pDynamicState; //depth test/write/compare
+		partInfo.layout = pipelineLayout;
+		partInfo.renderPass = renderPass;
+		partInfo.subpass = pipelineInfo.subpass;
+		parts[2] = acquireLibraryPart(pCache, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT, key, partInfo);
+	}
+	{
+		PipelineKey key;
+		key.Add(VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT);
+		addBlendState(key);
+		addMultisampleState(key);
+		key.Add(renderPass);
+		key.Add(pipelineInfo.subpass);
+
+		VkGraphicsPipelineCreateInfo partInfo{};
+		partInfo.pColorBlendState = pipelineInfo.pColorBlendState;
+		partInfo.pMultisampleState = pipelineInfo.pMultisampleState;
+		partInfo.renderPass = renderPass;
+		partInfo.subpass = pipelineInfo.subpass;
+		parts[3] = acquireLibraryPart(pCache, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT, key, partInfo);
+	}
+
+	libraryParts = parts;
+
+	PipelineKey linkKey;
+	linkKey.Add(VK_PIPELINE_CREATE_LIBRARY_BIT_KHR); //tags the key as a link, parts are identified by handle
+	linkKey.Add(parts);
+	linkKey.Add(pipelineLayout);
+
+	VkPipelineLibraryCreateInfoKHR libraries{};
+	libraries.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+	libraries.libraryCount = static_cast<uint32_t>(parts.size());
+	libraries.pLibraries = parts.data();
+
+	VkGraphicsPipelineCreateInfo linkInfo{};
+	linkInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	linkInfo.pNext = &libraries;
+	linkInfo.layout = pipelineLayout;
+	return pCache->AcquirePipeline(linkKey, linkInfo);
+}
 
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = numFramebuffers;
-	allocInfo.pSetLayouts = layouts.data();
+VkPipeline PipelineState::acquireLibraryPart(PipelineStateCache* pCache, VkGraphicsPipelineLibraryFlagBitsEXT part, const PipelineKey& key, VkGraphicsPipelineCreateInfo partInfo)
+{
+	VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+	libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+	libraryInfo.flags = part;
+
+	partInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	partInfo.pNext = &libraryInfo;
+	partInfo.flags |= VK_PIPELINE_CREATE_LIBRARY_BIT_KHR;
+	partInfo.basePipelineIndex = -1;
+
+	return pCache->AcquirePipeline(key, partInfo);
+}
+#endif
+
+void PipelineState::releaseCachedObjects()
+{
+	if (pipeline == VK_NULL_HANDLE && pipelineLayout == VK_NULL_HANDLE && descriptorSetLayout == VK_NULL_HANDLE)
+		return;
+
+	if (pDescriptorWriter)
+	{
+		pDescriptorWriter->Destroy(); //no update after this, the template can go right away
+		delete pDescriptorWriter;
+		pDescriptorWriter = nullptr;
+	}
 
-	VULKAN_CALL_ERROR(vkAllocateDescriptorSets(GPU, &allocInfo, descriptorSets.data()), "failed to allocate descriptor sets");
+	if (pDescriptorAllocator)
+	{
+		DescriptorAllocator* pAllocator = pDescriptorAllocator;
+		std::vector<VkDescriptorSet> oldSets;
+		for (VkDescriptorSet& set : descriptorSets)
+		{
+			if (set != VK_NULL_HANDLE) oldSets.push_back(set);
+			set = VK_NULL_HANDLE;
+		}
+		if (!oldSets.empty())
+		{
+			pDevice->GetDeletionQueue()->Enqueue([pAllocator, oldSets]()
+			{
+				for (VkDescriptorSet set : oldSets)
+					pAllocator->Free(set);
+			});
+		}
+	}
+
+	//the previous build may still be in flight
+	auto cache = pDevice->GetPipelineStateCache();
+	auto layoutCache = pDevice->GetDescriptorLayoutCache();
+	VkPipeline oldPipeline = pipeline;
+	VkPipelineLayout oldLayout = pipelineLayout;
+	VkDescriptorSetLayout oldSetLayout = descriptorSetLayout;
+	std::array<VkPipeline, 4> oldParts = libraryParts;
+	pDevice->GetDeletionQueue()->Enqueue([cache, layoutCache, oldPipeline, oldParts, oldLayout, oldSetLayout]()
+	{
+		if (oldPipeline != VK_NULL_HANDLE) cache->ReleasePipeline(oldPipeline);
+		for (VkPipeline part : oldParts)
+			if (part != VK_NULL_HANDLE) cache->ReleasePipeline(part);
+		if (oldLayout != VK_NULL_HANDLE) layoutCache->ReleasePipelineLayout(oldLayout);
+		if (oldSetLayout != VK_NULL_HANDLE) layoutCache->ReleaseDescriptorSetLayout(oldSetLayout);
+	});
+
+	pipeline = VK_NULL_HANDLE;
+	libraryParts = {};
+	pipelineLayout = VK_NULL_HANDLE;
+	descriptorSetLayout = VK_NULL_HANDLE;
 }
 
 VertexInputData::VertexInputData()
@@ -1,7 +1,14 @@
 #pragma once
 #include "includes.h"
+#include "PipelineStateCache.h"
+#include "JobSystem.h"
+#include <atomic>
 
 class Shader;
+class GraphicsDevice;
+class DescriptorAllocator;
+class DescriptorSetWriter;
+class BindlessResourceTable;
 
 struct VertexInputData
 {
@@ -21,29 +28,47 @@ struct BlendState
 
 class PipelineState
 {
+	friend class PipelineManifest; //reads and restores the description directly
 public:
-	PipelineState(VkDevice gpu, uint32_t numFramebuffers);
+	PipelineState(GraphicsDevice* pDevice, uint32_t numFramebuffers);
 	~PipelineState();
 
 	void SetShader(Shader* pShader);
-	void SetViewport(VkViewport viewport);
+	void SetViewport(VkViewport viewport); //viewport and scissor are dynamic state, set them while recording
 	void SetVertexInput(VertexInputData info);
 	void SetScissor(VkRect2D scissor);
 	void SetRasterizerState(VkPipelineRasterizationStateCreateInfo rasterizerState);
 	void SetMultisamplingState(VkPipelineMultisampleStateCreateInfo multisampleState);
 	void SetBlendState(BlendState blendState);
-	void SetPushConstantRange(VkPushConstantRange range);
+	void SetPushConstantRange(VkPushConstantRange range); //call once per stage or block, overlapping declarations merge per stage
 	void SetPrimitiveTopology(VkPrimitiveTopology topology);
 	void SetPrimitiveRestartEnable(VkBool32 primitiveRestartEnabled);
 	//void SetColorBlendState(VkPipelineColorBlendStateCreateInfo colorBlendState); redundant with BlendState structure member
 	void SetRenderPass(VkRenderPass pass);
 
-	VkDescriptorSet GetDescriptorSet(uint32_t index);
-	void RegisterDescriptorSetLayoutBinding(VkDescriptorSetLayoutBinding binding);
-	void SetDescriptorPool(VkDescriptorPool pool); //watch out for this
-	void UpdateUniformBufferDescriptor(uint32_t descriptorSetIndex, uint32_t descriptorBindingIndex, VkBuffer gpuBuffer, VkDeviceSize bindOffset, VkDeviceSize bindSize);
+	//cull mode, front face, topology (within its class) and depth test/write/compare become command buffer state,
+	//set with the DeviceContext::Set* calls. only takes effect on devices with extended dynamic state
+	void SetExtendedDynamicState(bool enable);
+	bool IsDynamic(VkDynamicState state) const;
 
-	void Build();
+	VkDescriptorSet GetDescriptorSet(uint32_t index); //applies pending descriptor writes first, get it right before binding
+	void RegisterDescriptorSetLayoutBinding(VkDescriptorSetLayoutBinding binding);
+	void SetDescriptorAllocator(DescriptorAllocator* pAllocator); //defaults to the device's persistent allocator
+	void SetBindlessTable(BindlessResourceTable* pTable); //table takes set 0, registered bindings move to set 1
+	uint32_t GetDescriptorSetIndex() const; //set number GetDescriptorSet binds at
+	void UpdateUniformBufferDescriptor(uint32_t descriptorSetIndex, uint32_t descriptorBindingIndex, VkBuffer gpuBuffer, VkDeviceSize bindOffset, VkDeviceSize bindSize); //skipped when unchanged
+
+	void Build(); //pipeline and layouts come from the device's PipelineStateCache, identical states share them
+
+	//compiles the pipeline on a worker. the state must not be modified until the returned job completes,
+	//until then Resolve hands out the fallback (or nothing) instead of stalling the frame
+	JobHandle BuildAsync(JobSystem* pJobs);
+	bool IsReady() const;
+	void SetFallback(PipelineState* pFallback); //a cheap, already built state with a compatible layout
+	PipelineState* Resolve(); //this when built, the fallback while compiling, nullptr to skip the draw
+
+	void Destroy(); //hands the shared objects back once the GPU is done with them
+	size_t GetHash() const; //content hash of the last build
 	VkPipeline GetPipeline() const;
 	VkPipelineLayout GetPipelineLayout() const; //probably replace this with something better
 private:
@@ -56,6 +81,31 @@ private:
 	std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings;
 
 	void createDescriptorSetLayout();
+	PipelineKey buildKey() const;
+	void addShaderStage(PipelineKey& key, const VkPipelineShaderStageCreateInfo& stage) const;
+	void addVertexInputState(PipelineKey& key) const;
+	void addRasterizationState(PipelineKey& key) const;
+	void addMultisampleState(PipelineKey& key) const;
+	void addBlendState(PipelineKey& key) const;
+	void addDynamicState(PipelineKey& key) const;
+
+	VkPipeline compilePipeline(const PipelineKey& key); //monolithic, or linked from library parts when the device supports it
+#ifdef VK_EXT_graphics_pipeline_library
+	VkPipeline linkPipelineLibrary(PipelineStateCache* pCache);
+	VkPipeline acquireLibraryPart(PipelineStateCache* pCache, VkGraphicsPipelineLibraryFlagBitsEXT part, const PipelineKey& key, VkGraphicsPipelineCreateInfo partInfo);
+#endif
+	std::array<VkPipeline, 4> libraryParts; //vertex input, pre-rasterization, fragment shader, fragment output
+	void releaseCachedObjects();
+	PipelineKey prepareBuild(); //everything up to the pipeline compile
+	void waitForBuild();
+
+	std::atomic<bool> ready;
+	std::atomic<bool> hitchRecorded;
+	PipelineState* pFallback;
+	JobSystem* pBuildJobs;
+	JobHandle buildJob;
+	std::exception_ptr buildError;
+	size_t hash;
 	void createDescriptorSets();
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo;
@@ -67,6 +117,11 @@ private:
 	VkPipelineViewportStateCreateInfo viewportState;
 	VkRect2D scissor;
 
+	std::vector<VkDynamicState> dynamicStates;
+	bool extendedDynamicState;
+	void updateDynamicStates();
+	VkPipelineDynamicStateCreateInfo dynamicState;
+
 	VkPipelineRasterizationStateCreateInfo rasterizerState;
 
 	VkPipelineMultisampleStateCreateInfo multisampleState;
@@ -75,16 +130,17 @@ private:
 
 	//VkPipelineColorBlendStateCreateInfo colorBlendState;
 
-	VkPipelineLayoutCreateInfo  pipelineLayoutInfo;
 	VkPipelineLayout pipelineLayout;
 	VkGraphicsPipelineCreateInfo pipelineInfo;
 
 	VkDescriptorSetLayout descriptorSetLayout;
-	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo;
 	VkRenderPass renderPass;
 
-	VkDescriptorPool descriptorPool;
+	DescriptorAllocator* pDescriptorAllocator;
+	DescriptorSetWriter* pDescriptorWriter; //one update template per build, tied to descriptorSetLayout
+	BindlessResourceTable* pBindless;
 
+	GraphicsDevice* pDevice;
 	VkDevice GPU;
 
 	bool dirty;
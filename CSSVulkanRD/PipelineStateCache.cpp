@@ -0,0 +1,110 @@
+#include "PipelineStateCache.h"
+
+PipelineStateCache::PipelineStateCache(VkDevice GPU, VkPipelineCache pipelineCache)
+{
+	this->GPU = GPU;
+	this->pipelineCache = pipelineCache;
+	hits = 0;
+	misses = 0;
+	asyncBuilds = 0;
+	hitchesAvoided = 0;
+	fallbackDraws = 0;
+	skippedDraws = 0;
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+}
+
+VkPipeline PipelineStateCache::AcquirePipeline(const PipelineKey& key, const VkGraphicsPipelineCreateInfo& pipelineInfo)
+{
+	size_t hash = key.Hash();
+
+	{
+		std::lock_guard<std::mutex> _lock(lock);
+
+		VkPipeline pipeline = pipelines.Find(key, hash);
+		if (pipeline != VK_NULL_HANDLE)
+		{
+			hits++;
+			return pipeline;
+		}
+	}
+
+	//compile outside the lock so other threads keep hitting the cache meanwhile
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VULKAN_CALL_ERROR(vkCreateGraphicsPipelines(GPU, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline), "failed to create graphics pipeline");
+
+	std::lock_guard<std::mutex> _lock(lock);
+
+	VkPipeline existing = pipelines.Find(key, hash); //another thread built the same state while we compiled
+	if (existing != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(GPU, pipeline, nullptr);
+		hits++;
+		return existing;
+	}
+
+	pipelines.Insert(key, hash, pipeline);
+	misses++;
+	return pipeline;
+}
+
+void PipelineStateCache::ReleasePipeline(VkPipeline pipeline)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	if (pipelines.Release(pipeline))
+		vkDestroyPipeline(GPU, pipeline, nullptr);
+}
+
+PipelineStateCacheStats PipelineStateCache::GetStats()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	PipelineStateCacheStats stats{};
+	stats.pipelines = pipelines.Size();
+	stats.hits = hits;
+	stats.misses = misses;
+	stats.asyncBuilds = asyncBuilds.load();
+	stats.hitchesAvoided = hitchesAvoided.load();
+	stats.fallbackDraws = fallbackDraws.load();
+	stats.skippedDraws = skippedDraws.load();
+	return stats;
+}
+
+void PipelineStateCache::PrintStats()
+{
+	PipelineStateCacheStats stats = GetStats();
+	std::cout << "pipelines: " << stats.pipelines << " unique, " << stats.hits << " hits, " << stats.misses << " misses" << std::endl;
+	std::cout << "async pipeline builds: " << stats.asyncBuilds << ", hitches avoided: " << stats.hitchesAvoided
+		<< ", fallback draws: " << stats.fallbackDraws << ", skipped draws: " << stats.skippedDraws << std::endl;
+}
+
+void PipelineStateCache::RecordAsyncBuild()
+{
+	asyncBuilds.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PipelineStateCache::RecordAvoidedHitch()
+{
+	hitchesAvoided.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PipelineStateCache::RecordFallbackDraw()
+{
+	fallbackDraws.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PipelineStateCache::RecordSkippedDraw()
+{
+	skippedDraws.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PipelineStateCache::Destroy()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	for (VkPipeline pipeline : pipelines.Clear())
+		vkDestroyPipeline(GPU, pipeline, nullptr);
+}
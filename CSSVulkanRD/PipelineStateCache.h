@@ -0,0 +1,53 @@
+#pragma once
+#include "includes.h"
+#include "PipelineKey.h"
+#include <atomic>
+
+struct PipelineStateCacheStats
+{
+	uint32_t pipelines;
+	uint64_t hits;   //acquires satisfied by an existing object
+	uint64_t misses; //acquires that had to create one
+
+	uint64_t asyncBuilds;
+	uint64_t hitchesAvoided; //async builds that were needed for drawing before they finished compiling
+	uint64_t fallbackDraws;
+	uint64_t skippedDraws;
+};
+
+//device wide, refcounted pipelines keyed on their content. materials with identical state share one VkPipeline.
+//layouts live in the DescriptorLayoutCache
+class PipelineStateCache
+{
+public:
+	PipelineStateCache(VkDevice GPU, VkPipelineCache pipelineCache);
+	~PipelineStateCache();
+
+	VkPipeline AcquirePipeline(const PipelineKey& key, const VkGraphicsPipelineCreateInfo& pipelineInfo); //key must describe everything pipelineInfo points at
+
+	void ReleasePipeline(VkPipeline pipeline);
+
+	PipelineStateCacheStats GetStats();
+	void PrintStats();
+
+	void RecordAsyncBuild();
+	void RecordAvoidedHitch();
+	void RecordFallbackDraw();
+	void RecordSkippedDraw();
+
+	void Destroy();
+private:
+	KeyedObjectTable<VkPipeline> pipelines;
+
+	uint64_t hits;
+	uint64_t misses;
+
+	std::atomic<uint64_t> asyncBuilds;
+	std::atomic<uint64_t> hitchesAvoided;
+	std::atomic<uint64_t> fallbackDraws;
+	std::atomic<uint64_t> skippedDraws;
+
+	std::mutex lock;
+	VkDevice GPU;
+	VkPipelineCache pipelineCache;
+};
@@ -0,0 +1,157 @@
+#include "PresentationController.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+PresentationController::PresentationController(uint32_t sampleWindow)
+{
+	this->sampleWindow = std::max(sampleWindow, 1u);
+	targetFrameRate = 0.0;
+	framePeriod = clock::duration::zero();
+	nextFrame = clock::now();
+	inputMarked = false;
+	hasPresented = false;
+	timer = nullptr;
+
+#ifdef _WIN32
+	//high resolution timers (win10 1803+) wake within ~0.5ms, older systems fall back to the regular one + spinning
+	timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!timer)
+		timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+#endif
+}
+
+PresentationController::~PresentationController()
+{
+#ifdef _WIN32
+	if (timer) CloseHandle((HANDLE)timer);
+#endif
+}
+
+void PresentationController::SetTargetFrameRate(double framesPerSecond)
+{
+	targetFrameRate = framesPerSecond;
+
+	if (framesPerSecond > 0.0)
+		framePeriod = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond));
+	else
+		framePeriod = clock::duration::zero();
+
+	nextFrame = clock::now();
+}
+
+double PresentationController::GetTargetFrameRate() const
+{
+	return targetFrameRate;
+}
+
+void PresentationController::WaitForNextFrame()
+{
+	if (framePeriod == clock::duration::zero())
+		return;
+
+	sleepUntil(nextFrame);
+
+	//schedule off the ideal timeline so jitter doesn't accumulate, but don't try to catch up after a long hitch
+	clock::time_point now = clock::now();
+	nextFrame += framePeriod;
+	if (nextFrame < now)
+		nextFrame = now + framePeriod;
+}
+
+void PresentationController::MarkInput()
+{
+	inputTime = clock::now();
+	inputMarked = true;
+}
+
+void PresentationController::OnPresent()
+{
+	clock::time_point now = clock::now();
+
+	if (hasPresented)
+	{
+		frameTimes.push_back(std::chrono::duration<double, std::milli>(now - lastPresent).count());
+		if (frameTimes.size() > sampleWindow) frameTimes.pop_front();
+	}
+
+	if (inputMarked)
+	{
+		latencies.push_back(std::chrono::duration<double, std::milli>(now - inputTime).count());
+		if (latencies.size() > sampleWindow) latencies.pop_front();
+		inputMarked = false;
+	}
+
+	lastPresent = now;
+	hasPresented = true;
+}
+
+PresentationStats PresentationController::GetStats() const
+{
+	PresentationStats stats{};
+
+	std::vector<double> frames(frameTimes.begin(), frameTimes.end());
+	std::vector<double> latency(latencies.begin(), latencies.end());
+
+	stats.frameTimeP50 = percentile(frames, 0.50);
+	stats.frameTimeP99 = percentile(frames, 0.99);
+	stats.latencyP50 = percentile(latency, 0.50);
+	stats.latencyP99 = percentile(latency, 0.99);
+	stats.sampleCount = (uint32_t)frames.size();
+	return stats;
+}
+
+void PresentationController::PrintStats() const
+{
+	PresentationStats stats = GetStats();
+	std::cout << "frame time p50 " << stats.frameTimeP50 << " ms, p99 " << stats.frameTimeP99 << " ms | input to present p50 "
+		<< stats.latencyP50 << " ms, p99 " << stats.latencyP99 << " ms (" << stats.sampleCount << " frames)" << std::endl;
+}
+
+void PresentationController::ResetStats()
+{
+	frameTimes.clear();
+	latencies.clear();
+	hasPresented = false;
+	inputMarked = false;
+}
+
+void PresentationController::sleepUntil(clock::time_point deadline)
+{
+	const clock::duration spinMargin = std::chrono::microseconds(500); //timer wakeups are late by up to this much
+
+	clock::time_point now = clock::now();
+	if (deadline - now > spinMargin)
+	{
+#ifdef _WIN32
+		if (timer)
+		{
+			LARGE_INTEGER dueTime;
+			dueTime.QuadPart = -(LONGLONG)(std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now - spinMargin).count() / 100); //relative, 100ns units
+			SetWaitableTimer((HANDLE)timer, &dueTime, 0, NULL, NULL, FALSE);
+			WaitForSingleObject((HANDLE)timer, INFINITE);
+		}
+		else
+#endif
+		{
+			std::this_thread::sleep_until(deadline - spinMargin);
+		}
+	}
+
+	while (clock::now() < deadline)
+		std::this_thread::yield();
+}
+
+double PresentationController::percentile(std::vector<double> samples, double p)
+{
+	if (samples.empty())
+		return 0.0;
+
+	size_t index = (size_t)(p * (samples.size() - 1) + 0.5);
+	std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+	return samples[index];
+}
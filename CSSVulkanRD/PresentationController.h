@@ -0,0 +1,54 @@
+#pragma once
+#include "includes.h"
+#include <chrono>
+#include <deque>
+
+struct PresentationStats
+{
+	double frameTimeP50; //ms between presents
+	double frameTimeP99;
+	double latencyP50;   //ms from MarkInput to the present call returning
+	double latencyP99;
+	uint32_t sampleCount;
+};
+
+//frame pacing and latency measurement. the application picks the present mode (through GraphicsDevice::SetPresentMode)
+//and a target frame rate, WaitForNextFrame sleeps on a high resolution timer until the next frame slot instead of a fixed Sleep
+class PresentationController
+{
+public:
+	PresentationController(uint32_t sampleWindow = 1024);
+	~PresentationController();
+
+	void SetTargetFrameRate(double framesPerSecond); //0 = unpaced, let the present mode decide
+	double GetTargetFrameRate() const;
+
+	void WaitForNextFrame(); //call at the top of the frame, before polling input
+	void MarkInput();        //call right after input has been sampled
+	void OnPresent();        //called by GraphicsDevice once the present was queued
+
+	PresentationStats GetStats() const;
+	void PrintStats() const;
+	void ResetStats();
+private:
+	typedef std::chrono::steady_clock clock;
+
+	double targetFrameRate;
+	clock::duration framePeriod;
+	clock::time_point nextFrame;
+
+	clock::time_point inputTime;
+	bool inputMarked;
+
+	clock::time_point lastPresent;
+	bool hasPresented;
+
+	uint32_t sampleWindow;
+	std::deque<double> frameTimes;
+	std::deque<double> latencies;
+
+	void* timer; //HANDLE on windows
+
+	void sleepUntil(clock::time_point deadline);
+	static double percentile(std::vector<double> samples, double p);
+};
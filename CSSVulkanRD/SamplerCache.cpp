@@ -0,0 +1,158 @@
+#include "SamplerCache.h"
+
+SamplerCache::SamplerCache(VkDevice GPU, uint32_t maxSamplerAllocationCount)
+{
+	this->GPU = GPU;
+	this->maxSamplerAllocationCount = maxSamplerAllocationCount;
+}
+
+SamplerCache::~SamplerCache()
+{
+}
+
+VkSampler SamplerCache::Acquire(const VkSamplerCreateInfo& samplerInfo)
+{
+	if (samplerInfo.pNext != nullptr)
+		throw std::runtime_error("sampler cache does not support extension structures"); //can't hash what we can't see
+
+	std::lock_guard<std::mutex> _lock(lock);
+
+	size_t hash = hashSamplerInfo(samplerInfo);
+
+	auto range = samplers.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (samplerInfoEqual(it->second->info, samplerInfo))
+		{
+			it->second->refCount++;
+			return it->second->sampler;
+		}
+	}
+
+	if (samplerLookup.size() >= maxSamplerAllocationCount)
+		throw std::runtime_error("sampler cache exceeded maxSamplerAllocationCount");
+
+	CachedSampler* pSampler = new CachedSampler();
+	pSampler->info = samplerInfo;
+	pSampler->refCount = 1;
+	pSampler->hash = hash;
+
+	VULKAN_CALL_ERROR(vkCreateSampler(GPU, &samplerInfo, nullptr, &pSampler->sampler), "failed to create sampler");
+
+	samplers.insert({ hash, pSampler });
+	samplerLookup[pSampler->sampler] = pSampler;
+
+	return pSampler->sampler;
+}
+
+void SamplerCache::Release(VkSampler sampler)
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	auto it = samplerLookup.find(sampler);
+	if (it == samplerLookup.end())
+		return;
+
+	CachedSampler* pSampler = it->second;
+	if (--pSampler->refCount > 0)
+		return;
+
+	vkDestroySampler(GPU, pSampler->sampler, nullptr);
+
+	auto range = samplers.equal_range(pSampler->hash);
+	for (auto s = range.first; s != range.second; ++s)
+	{
+		if (s->second == pSampler)
+		{
+			samplers.erase(s);
+			break;
+		}
+	}
+
+	samplerLookup.erase(it);
+	delete pSampler;
+}
+
+uint32_t SamplerCache::GetSamplerCount()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+	return (uint32_t)samplerLookup.size();
+}
+
+void SamplerCache::Destroy()
+{
+	std::lock_guard<std::mutex> _lock(lock);
+
+	for (auto& entry : samplerLookup)
+	{
+		vkDestroySampler(GPU, entry.second->sampler, nullptr);
+		delete entry.second;
+	}
+
+	samplers.clear();
+	samplerLookup.clear();
+}
+
+VkSamplerCreateInfo SamplerCache::DefaultSamplerDesc(VkFilter filter, VkSamplerAddressMode addressMode)
+{
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = filter;
+	samplerInfo.minFilter = filter;
+	samplerInfo.mipmapMode = filter == VK_FILTER_LINEAR ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = addressMode;
+	samplerInfo.addressModeV = addressMode;
+	samplerInfo.addressModeW = addressMode;
+	samplerInfo.mipLodBias = 0.0f;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 1.0f;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	return samplerInfo;
+}
+
+size_t SamplerCache::hashSamplerInfo(const VkSamplerCreateInfo& samplerInfo)
+{
+	size_t hash = 0;
+	HashCombine(hash, samplerInfo.flags);
+	HashCombine(hash, samplerInfo.magFilter);
+	HashCombine(hash, samplerInfo.minFilter);
+	HashCombine(hash, samplerInfo.mipmapMode);
+	HashCombine(hash, samplerInfo.addressModeU);
+	HashCombine(hash, samplerInfo.addressModeV);
+	HashCombine(hash, samplerInfo.addressModeW);
+	HashCombine(hash, samplerInfo.mipLodBias);
+	HashCombine(hash, samplerInfo.anisotropyEnable);
+	HashCombine(hash, samplerInfo.maxAnisotropy);
+	HashCombine(hash, samplerInfo.compareEnable);
+	HashCombine(hash, samplerInfo.compareOp);
+	HashCombine(hash, samplerInfo.minLod);
+	HashCombine(hash, samplerInfo.maxLod);
+	HashCombine(hash, samplerInfo.borderColor);
+	HashCombine(hash, samplerInfo.unnormalizedCoordinates);
+	return hash;
+}
+
+bool SamplerCache::samplerInfoEqual(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b)
+{
+	return a.flags == b.flags &&
+		a.magFilter == b.magFilter &&
+		a.minFilter == b.minFilter &&
+		a.mipmapMode == b.mipmapMode &&
+		a.addressModeU == b.addressModeU &&
+		a.addressModeV == b.addressModeV &&
+		a.addressModeW == b.addressModeW &&
+		a.mipLodBias == b.mipLodBias &&
+		a.anisotropyEnable == b.anisotropyEnable &&
+		a.maxAnisotropy == b.maxAnisotropy &&
+		a.compareEnable == b.compareEnable &&
+		a.compareOp == b.compareOp &&
+		a.minLod == b.minLod &&
+		a.maxLod == b.maxLod &&
+		a.borderColor == b.borderColor &&
+		a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "includes.h"
+#include <unordered_map>
+
+//hands out shared, refcounted samplers. identical create infos resolve to the same VkSampler,
+//which keeps the sampler count well under maxSamplerAllocationCount
+class SamplerCache
+{
+public:
+	SamplerCache(VkDevice GPU, uint32_t maxSamplerAllocationCount);
+	~SamplerCache();
+
+	VkSampler Acquire(const VkSamplerCreateInfo& samplerInfo);
+	void Release(VkSampler sampler);
+
+	uint32_t GetSamplerCount();
+
+	void Destroy();
+
+	static VkSamplerCreateInfo DefaultSamplerDesc(VkFilter filter = VK_FILTER_LINEAR, VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
+private:
+	struct CachedSampler
+	{
+		VkSamplerCreateInfo info;
+		VkSampler sampler;
+		uint32_t refCount;
+		size_t hash;
+	};
+
+	std::unordered_multimap<size_t, CachedSampler*> samplers;
+	std::unordered_map<VkSampler, CachedSampler*> samplerLookup;
+
+	std::mutex lock;
+	VkDevice GPU;
+	uint32_t maxSamplerAllocationCount;
+
+	static size_t hashSamplerInfo(const VkSamplerCreateInfo& samplerInfo);
+	static bool samplerInfoEqual(const VkSamplerCreateInfo& a, const VkSamplerCreateInfo& b);
+};
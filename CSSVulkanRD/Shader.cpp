@@ -3,6 +3,9 @@
 Shader::Shader(VkDevice gpu)
 {
 	GPU = gpu;
+	vertexStageExists = false;
+	fragmentStageExists = false;
+	computeStageExists = false;
 }
 
 Shader::~Shader()
@@ -22,7 +25,8 @@ void Shader::LoadShader(const char* shaderFile, const char* entrypoint, VkShader
 			VertexShader->entrypoint = entrypoint;
 			VertexShader->module = module;
 			VertexShader->stage = stage;
-			VertexShader->bytecode = code.data(); //unsure now necessary it will be to keep cpu copy of shader bytecode indefinitely
+			VertexShader->codeHash = hashCode(code);
+			VertexShader->path = shaderFile;
 			vertexStageExists = true;
 
 			break;
@@ -36,7 +40,8 @@ void Shader::LoadShader(const char* shaderFile, const char* entrypoint, VkShader
 			PixelShader->entrypoint = entrypoint;
 			PixelShader->module = module;
 			PixelShader->stage = stage;
-			PixelShader->bytecode = code.data(); //unsure now necessary it will be to keep cpu copy of shader bytecode indefinitely
+			PixelShader->codeHash = hashCode(code);
+			PixelShader->path = shaderFile;
 			fragmentStageExists = true;
 
 			break;
@@ -50,7 +55,8 @@ void Shader::LoadShader(const char* shaderFile, const char* entrypoint, VkShader
 			ComputeShader->entrypoint = entrypoint;
 			ComputeShader->module = module;
 			ComputeShader->stage = stage;
-			ComputeShader->bytecode = code.data(); //unsure now necessary it will be to keep cpu copy of shader bytecode indefinitely
+			ComputeShader->codeHash = hashCode(code);
+			ComputeShader->path = shaderFile;
 			computeStageExists = true;
 
 			break;
@@ -155,6 +161,11 @@ bool Shader::StageExists(VkShaderStageFlagBits stage)
 	return false;
 }
 
+size_t Shader::hashCode(const std::vector<char>& bytecode)
+{
+	return std::hash<std::string_view>{}(std::string_view(bytecode.data(), bytecode.size()));
+}
+
 VkShaderModule Shader::createShader(const std::vector<char>& bytecode)
 {
 	VkShaderModuleCreateInfo createInfo{};
@@ -190,6 +201,7 @@ std::vector<char> readFile(const std::string& filename)
 
 ShaderResource::ShaderResource()
 {
+	codeHash = 0;
 }
 
 ShaderResource::~ShaderResource()
@@ -1,12 +1,14 @@
 #pragma once
 #include "includes.h"
+#include <string_view>
 
 struct ShaderResource
 {
 	VkShaderModule module;
 	VkShaderStageFlagBits stage;
 	const char* entrypoint;
-	char* bytecode;
+	size_t codeHash; //of the SPIR-V, identifies the module's contents for pipeline hashing
+	std::string path; //source file, lets the pipeline manifest reload it
 
 	ShaderResource();
 	~ShaderResource();
@@ -38,4 +40,5 @@ private:
 	uint32_t computeStageExists : 1;
 
 	VkShaderModule createShader(const std::vector<char>& bytecode);
+	static size_t hashCode(const std::vector<char>& bytecode);
 };
\ No newline at end of file
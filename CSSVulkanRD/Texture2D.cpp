@@ -2,13 +2,18 @@
 #include "GraphicsDevice.h"
 #include "GPUBuffer.h"
 #include "DeviceContext.h"
+#include "ImageViewCache.h"
 
 Texture2D::Texture2D(GraphicsDevice* pDevice) : GPUResource(pDevice)
 {
 	width = 0;
 	height = 0;
+	arrayLayers = 1;
+	mapped = false;
+	mappable = false;
 	format = VK_FORMAT_UNDEFINED;
 	desc = {};
+	view = VK_NULL_HANDLE;
 }
 
 Texture2D::~Texture2D()
@@ -16,18 +21,33 @@ Texture2D::~Texture2D()
 }
 
 void Texture2D::Create(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags imageUsageFlags,bool mappable, bool allocateGPUMemory)
+{
+	this->mappable = mappable;
+	createImage(width, height, 1, format, imageUsageFlags, allocateGPUMemory);
+}
+
+void Texture2D::CreateArray(uint32_t width, uint32_t height, uint32_t arrayLayers, VkFormat format, VkImageUsageFlags imageUsageFlags, bool allocateGPUMemory)
+{
+	this->mappable = false; //texture arrays are always device local
+	createImage(width, height, arrayLayers, format, imageUsageFlags, allocateGPUMemory);
+}
+
+void Texture2D::createImage(uint32_t width, uint32_t height, uint32_t arrayLayers, VkFormat format, VkImageUsageFlags imageUsageFlags, bool allocateGPUMemory)
 {
 	this->width = width;
 	this->height = height;
+	this->arrayLayers = arrayLayers;
 	this->format = format;
-	this->mappable = mappable;
 
 	desc.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	desc.imageType = VK_IMAGE_TYPE_2D;
 	desc.format = format;
 	desc.extent.width = width;
 	desc.extent.height = height;
 	desc.extent.depth = 1; //2D texture only
 	desc.mipLevels = 1; //mip levels other than 1 currently not supported by catastrophic engine
+	desc.arrayLayers = arrayLayers;
+	desc.samples = VK_SAMPLE_COUNT_1_BIT;
 	desc.tiling = VK_IMAGE_TILING_OPTIMAL;
 	desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	desc.usage = imageUsageFlags;
@@ -39,6 +59,12 @@ void Texture2D::Create(uint32_t width, uint32_t height, VkFormat format, VkImage
 	VULKAN_CALL_ERROR(vkCreateImage(GPU, &desc, nullptr, &texture), "failed to create texture2D");
 	vkGetImageMemoryRequirements(GPU, texture, &memoryRequirements);
 
+	stateTracker.Initialize(texture, VK_IMAGE_ASPECT_COLOR_BIT, desc.mipLevels, arrayLayers);
+
+	//size of the tightly packed texel data Update() expects, the allocation itself may be larger
+	size = (VkDeviceSize)width * height * arrayLayers * GetFormatTexelSize(format);
+	if (size == 0) size = memoryRequirements.size;
+
 	if (allocateGPUMemory)
 	{
 		AllocateGPUMemory();
@@ -47,6 +73,13 @@ void Texture2D::Create(uint32_t width, uint32_t height, VkFormat format, VkImage
 
 void Texture2D::Destroy()
 {
+	if (view != VK_NULL_HANDLE)
+	{
+		pDevice->GetImageViewCache()->Release(view);
+		view = VK_NULL_HANDLE;
+	}
+	pDevice->GetImageViewCache()->ReleaseImage(texture);
+
 	vkDestroyImage(GPU, texture, nullptr);
 	if (gpuMemoryAllocated)
 	{
@@ -77,16 +110,22 @@ void Texture2D::Update(void* pData)
 	if (mappable)
 	{
 		void* pMem = Map();
-		memcpy(pMem, pData, memoryRequirements.size);
+		memcpy(pMem, pData, size);
 		UnMap();
 	}
 	else
 	{
 		void* pStagingMem = stagingBuffer->Map();
-		memcpy(pStagingMem, pData, memoryRequirements.size);
+		memcpy(pStagingMem, pData, size);
 		stagingBuffer->UnMap();
 
-		auto xfrCmd = pDevice->GetTransferContext()->GetCommandBuffer(true);
+		//layout transitions need a graphics capable queue, record the whole upload on the immediate context
+		auto cmdBuf = pDevice->ImmediateContext->GetCommandBuffer(true);
+
+		BarrierBatch barriers;
+		stateTracker.Transition(barriers, ImageUsage::Undefined); //whole image is overwritten, old contents don't matter
+		stateTracker.Transition(barriers, ImageUsage::CopyDst);
+		barriers.Flush(cmdBuf->handle);
 
 		VkBufferImageCopy region{};
 		region.bufferOffset = 0;
@@ -96,7 +135,7 @@ void Texture2D::Update(void* pData)
 		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 		region.imageSubresource.mipLevel = 0;
 		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = 1;
+		region.imageSubresource.layerCount = arrayLayers; //layers are packed back to back in the staging buffer
 
 		region.imageOffset = { 0, 0, 0 };
 		region.imageExtent = {
@@ -105,9 +144,13 @@ void Texture2D::Update(void* pData)
 			1
 		};
 
-		vkCmdCopyBufferToImage(xfrCmd->handle, stagingBuffer->GetBuffer(), texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,1, &region);
+		vkCmdCopyBufferToImage(cmdBuf->handle, stagingBuffer->GetBuffer(), texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,1, &region);
+
+		stateTracker.Transition(barriers, ImageUsage::Sampled);
+		barriers.Flush(cmdBuf->handle);
 
-		transitionImageLayout(desc.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		vkEndCommandBuffer(cmdBuf->handle);
+		pDevice->ImmediateContext->SubmitCommandBuffer(cmdBuf, true);
 	}
 }
 
@@ -123,6 +166,18 @@ void* Texture2D::Map()
 	return nullptr;
 }
 
+void* Texture2D::Map(VkDeviceSize offset, VkDeviceSize size)
+{
+	if (mappable && !mapped)
+	{
+		void* pGPUMemoryRegion = nullptr;
+		VULKAN_CALL_ERROR(vkMapMemory(GPU, textureMem->handle, offset, size, 0, &pGPUMemoryRegion), "failed to map texture2D gpu memory");
+		mapped = true;
+		return pGPUMemoryRegion;
+	}
+	return nullptr;
+}
+
 void Texture2D::UnMap()
 {
 	if (mappable && mapped)
@@ -132,56 +187,82 @@ void Texture2D::UnMap()
 	}
 }
 
-void Texture2D::transitionImageLayout(VkFormat format, VkImageLayout prevLayout, VkImageLayout newLayout)
+VkImage Texture2D::GetImage() const
 {
-	auto cmdBuf = pDevice->ImmediateContext->GetCommandBuffer(true);
+	return texture;
+}
 
-	VkImageMemoryBarrier barrier{};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.oldLayout = prevLayout;
-	barrier.newLayout = newLayout;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.image = texture;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-	barrier.srcAccessMask = 0; // TODO
-	barrier.dstAccessMask = 0; // TODO
+VkImageView Texture2D::GetView()
+{
+	if (view == VK_NULL_HANDLE)
+	{
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = texture;
+		viewInfo.viewType = arrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = arrayLayers;
 
-	VkPipelineStageFlags sourceStage;
-	VkPipelineStageFlags destinationStage;
+		view = pDevice->GetImageViewCache()->Acquire(viewInfo);
+	}
+	return view;
+}
 
-	if (prevLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+VkFormat Texture2D::GetFormat() const
+{
+	return format;
+}
 
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	}
-	else if (prevLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+uint32_t Texture2D::GetWidth() const
+{
+	return width;
+}
 
-		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	}
-	else {
-		throw std::invalid_argument("unsupported layout transition!");
-	}
+uint32_t Texture2D::GetHeight() const
+{
+	return height;
+}
 
-	vkCmdPipelineBarrier(
-		cmdBuf->handle,
-		sourceStage, destinationStage,
-		0,
-		0, nullptr,
-		0, nullptr,
-		1, &barrier
-	);
+uint32_t Texture2D::GetArrayLayers() const
+{
+	return arrayLayers;
+}
 
-	pDevice->ImmediateContext->SubmitCommandBuffer(cmdBuf, nullptr);
+ImageStateTracker* Texture2D::GetStateTracker()
+{
+	return &stateTracker;
+}
+
+uint32_t Texture2D::GetFormatTexelSize(VkFormat format)
+{
+	switch (format)
+	{
+		case VK_FORMAT_R8_UNORM:
+		case VK_FORMAT_R8_SRGB:
+			return 1;
+		case VK_FORMAT_R8G8_UNORM:
+		case VK_FORMAT_R16_SFLOAT:
+			return 2;
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+		case VK_FORMAT_R16G16_SFLOAT:
+		case VK_FORMAT_R32_SFLOAT:
+		case VK_FORMAT_R32_UINT:
+			return 4;
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+		case VK_FORMAT_R32G32_SFLOAT:
+			return 8;
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+			return 16;
+		default:
+			return 0;
+	}
 }
 
 void Texture2D::createStagingResource()
@@ -3,6 +3,7 @@
 #include <memory>
 #include "GPUResource.h"
 #include "GPUMemoryManager.h"
+#include "ImageStateTracker.h"
 
 class GraphicsDevice;
 class GPUBuffer;
@@ -14,20 +15,35 @@ public:
 	~Texture2D();
 
 	void Create(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags imageUsageFlags,bool mappable=false, bool allocateGPUMemory=true);
+	void CreateArray(uint32_t width, uint32_t height, uint32_t arrayLayers, VkFormat format, VkImageUsageFlags imageUsageFlags, bool allocateGPUMemory=true);
 
 	virtual void Destroy() override;
 	virtual void AllocateGPUMemory() override;
 	virtual void Update(void* pData) override;
 
 	virtual void* Map() override;
+	virtual void* Map(VkDeviceSize offset, VkDeviceSize size) override;
 	virtual void UnMap() override;
+
+	VkImage GetImage() const;
+	VkImageView GetView(); //default view over every layer, shared through the device image view cache
+	VkFormat GetFormat() const;
+	uint32_t GetWidth() const;
+	uint32_t GetHeight() const;
+	uint32_t GetArrayLayers() const;
+
+	ImageStateTracker* GetStateTracker(); //declare usage through this before recording commands that touch the texture
+
+	static uint32_t GetFormatTexelSize(VkFormat format); //0 for formats the engine doesn't know the size of
 private:
 	VkImage texture;
 	GPUBuffer* stagingBuffer;
 
 	VkImageCreateInfo desc;
+	VkImageView view;
+	ImageStateTracker stateTracker;
 
-	void transitionImageLayout(VkFormat format, VkImageLayout prevLayout, VkImageLayout newLayout);
+	void createImage(uint32_t width, uint32_t height, uint32_t arrayLayers, VkFormat format, VkImageUsageFlags imageUsageFlags, bool allocateGPUMemory);
 
 	GPUMemoryAllocation* textureMem;
 	GPUMemoryAllocation* stagingMem;
@@ -36,5 +52,6 @@ private:
 
 	uint32_t width;
 	uint32_t height;
+	uint32_t arrayLayers;
 	VkFormat format;
 };
\ No newline at end of file
@@ -0,0 +1,428 @@
+#include "TextureAtlas.h"
+#include "GraphicsDevice.h"
+#include "Texture2D.h"
+#include "ImageViewCache.h"
+
+SkylinePacker::SkylinePacker()
+{
+	width = 0;
+	height = 0;
+	usedArea = 0;
+}
+
+SkylinePacker::~SkylinePacker()
+{
+}
+
+void SkylinePacker::Reset(uint32_t width, uint32_t height)
+{
+	this->width = width;
+	this->height = height;
+	usedArea = 0;
+
+	skyline.clear();
+	skyline.push_back({ 0, 0, width });
+}
+
+bool SkylinePacker::Pack(uint32_t width, uint32_t height, uint32_t& outX, uint32_t& outY)
+{
+	size_t bestIndex = SIZE_MAX;
+	uint32_t bestTop = UINT32_MAX;
+	uint32_t bestNodeWidth = UINT32_MAX;
+	uint32_t bestY = 0;
+
+	//bottom-left rule: lowest resulting top edge wins, narrowest skyline segment breaks ties
+	for (size_t i = 0; i < skyline.size(); ++i)
+	{
+		uint32_t y = 0;
+		if (fits(i, width, height, y))
+		{
+			uint32_t top = y + height;
+			if (top < bestTop || (top == bestTop && skyline[i].width < bestNodeWidth))
+			{
+				bestIndex = i;
+				bestTop = top;
+				bestNodeWidth = skyline[i].width;
+				bestY = y;
+			}
+		}
+	}
+
+	if (bestIndex == SIZE_MAX)
+		return false;
+
+	outX = skyline[bestIndex].x;
+	outY = bestY;
+
+	addLevel(bestIndex, outX, outY, width, height);
+	usedArea += (uint64_t)width * height;
+	return true;
+}
+
+float SkylinePacker::GetOccupancy() const
+{
+	if (width == 0 || height == 0) return 0.0f;
+	return (float)((double)usedArea / ((double)width * height));
+}
+
+bool SkylinePacker::fits(size_t nodeIndex, uint32_t width, uint32_t height, uint32_t& outY) const
+{
+	if (skyline[nodeIndex].x + width > this->width)
+		return false;
+
+	uint32_t y = skyline[nodeIndex].y;
+	uint32_t widthLeft = width;
+	size_t i = nodeIndex;
+
+	while (widthLeft > 0)
+	{
+		if (i >= skyline.size())
+			return false;
+
+		y = std::max(y, skyline[i].y);
+		if (y + height > this->height)
+			return false;
+
+		if (skyline[i].width >= widthLeft)
+			break;
+
+		widthLeft -= skyline[i].width;
+		++i;
+	}
+
+	outY = y;
+	return true;
+}
+
+void SkylinePacker::addLevel(size_t nodeIndex, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	skyline.insert(skyline.begin() + nodeIndex, { x, y + height, width });
+
+	//trim or drop the segments now covered by the new one
+	for (size_t i = nodeIndex + 1; i < skyline.size();)
+	{
+		const SkylineNode& prev = skyline[i - 1];
+		uint32_t prevEnd = prev.x + prev.width;
+
+		if (skyline[i].x >= prevEnd)
+			break;
+
+		uint32_t shrink = prevEnd - skyline[i].x;
+		if (skyline[i].width <= shrink)
+		{
+			skyline.erase(skyline.begin() + i);
+			continue;
+		}
+
+		skyline[i].x += shrink;
+		skyline[i].width -= shrink;
+		break;
+	}
+
+	//merge neighbours at the same height
+	for (size_t i = 0; i + 1 < skyline.size();)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+TextureAtlas::TextureAtlas(GraphicsDevice* pDevice)
+{
+	this->pDevice = pDevice;
+	GPU = pDevice->GetGPU();
+
+	pTexture = nullptr;
+	view = VK_NULL_HANDLE;
+	viewType = VK_IMAGE_VIEW_TYPE_2D;
+
+	pageWidth = 2048;
+	pageHeight = 2048;
+	pageCount = 0;
+	padding = 2;
+	mipLevels = 1;
+	format = VK_FORMAT_R8G8B8A8_UNORM;
+	texelSize = Texture2D::GetFormatTexelSize(format);
+
+	built = false;
+}
+
+TextureAtlas::~TextureAtlas()
+{
+}
+
+void TextureAtlas::SetPageSize(uint32_t width, uint32_t height)
+{
+	pageWidth = width;
+	pageHeight = height;
+}
+
+void TextureAtlas::SetPadding(uint32_t padding)
+{
+	this->padding = padding;
+}
+
+void TextureAtlas::SetMipLevels(uint32_t mipLevels)
+{
+	this->mipLevels = std::max(mipLevels, 1u);
+}
+
+void TextureAtlas::SetFormat(VkFormat format)
+{
+	if (!images.empty())
+		throw std::runtime_error("texture atlas format must be set before images are added");
+
+	texelSize = Texture2D::GetFormatTexelSize(format);
+	if (texelSize == 0)
+		throw std::runtime_error("texture atlas format not supported");
+
+	this->format = format;
+}
+
+uint32_t TextureAtlas::AddImage(uint32_t width, uint32_t height, const void* pPixels)
+{
+	if (built)
+		throw std::runtime_error("cannot add images to a texture atlas that has already been built");
+	if (width == 0 || height == 0)
+		throw std::runtime_error("texture atlas image has no texels"); //the padded blit clamps to width - 1 / height - 1
+	if (!pPixels)
+		throw std::runtime_error("texture atlas image has no pixel data");
+
+	PendingImage image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize((size_t)width * height * texelSize);
+	memcpy(image.pixels.data(), pPixels, image.pixels.size());
+
+	images.push_back(std::move(image));
+	return (uint32_t)images.size() - 1;
+}
+
+void TextureAtlas::Build()
+{
+	if (built)
+		throw std::runtime_error("texture atlas already built");
+	if (images.empty())
+		throw std::runtime_error("texture atlas has no images");
+
+	auto limits = pDevice->GetDeviceProperties().limits;
+	pageWidth = std::min(pageWidth, limits.maxImageDimension2D);
+	pageHeight = std::min(pageHeight, limits.maxImageDimension2D);
+
+	regions.resize(images.size());
+
+	//same sized images don't need packing, a layer each wraps/filters exactly like standalone textures
+	if (images.size() > 1 && imagesShareSize() && images.size() <= limits.maxImageArrayLayers)
+	{
+		buildArray();
+	}
+	else
+	{
+		buildAtlas();
+		if (pageCount > limits.maxImageArrayLayers)
+			throw std::runtime_error("texture atlas needs more pages than the GPU supports array layers");
+	}
+
+	images.clear(); //cpu copies no longer needed
+	images.shrink_to_fit();
+	built = true;
+}
+
+AtlasRegion TextureAtlas::GetRegion(uint32_t handle) const
+{
+	return regions[handle];
+}
+
+Texture2D* TextureAtlas::GetTexture() const
+{
+	return pTexture;
+}
+
+VkImageView TextureAtlas::GetView() const
+{
+	return view;
+}
+
+VkImageViewType TextureAtlas::GetViewType() const
+{
+	return viewType;
+}
+
+uint32_t TextureAtlas::GetPageCount() const
+{
+	return pageCount;
+}
+
+void TextureAtlas::Destroy()
+{
+	if (view != VK_NULL_HANDLE)
+	{
+		pDevice->GetImageViewCache()->Release(view);
+		view = VK_NULL_HANDLE;
+	}
+
+	if (pTexture)
+	{
+		pTexture->Destroy();
+		delete pTexture;
+		pTexture = nullptr;
+	}
+
+	regions.clear();
+	images.clear();
+	pageCount = 0;
+	built = false;
+}
+
+bool TextureAtlas::imagesShareSize() const
+{
+	for (const PendingImage& image : images)
+	{
+		if (image.width != images[0].width || image.height != images[0].height)
+			return false;
+	}
+	return true;
+}
+
+void TextureAtlas::buildArray()
+{
+	uint32_t width = images[0].width;
+	uint32_t height = images[0].height;
+	size_t layerSize = (size_t)width * height * texelSize;
+
+	std::vector<uint8_t> texels(layerSize * images.size());
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		memcpy(texels.data() + layerSize * i, images[i].pixels.data(), layerSize);
+
+		AtlasRegion& region = regions[i];
+		region.layer = (uint32_t)i;
+		region.x = 0;
+		region.y = 0;
+		region.width = width;
+		region.height = height;
+		region.uvMin = glm::vec2(0.0f, 0.0f);
+		region.uvMax = glm::vec2(1.0f, 1.0f);
+	}
+
+	pageCount = (uint32_t)images.size();
+	viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+	createTexture(width, height, pageCount, texels);
+}
+
+void TextureAtlas::buildAtlas()
+{
+	//every cell is aligned to the footprint of one texel of the smallest mip, so no mip ever averages two images together
+	uint32_t alignment = 1u << (mipLevels - 1);
+	uint32_t pageUnitsX = pageWidth / alignment;
+	uint32_t pageUnitsY = pageHeight / alignment;
+
+	std::vector<uint32_t> order(images.size());
+	for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+
+	//tallest first keeps the skyline flat
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+	{
+		if (images[a].height != images[b].height) return images[a].height > images[b].height;
+		return images[a].width > images[b].width;
+	});
+
+	std::vector<SkylinePacker> pages;
+	std::vector<VkRect2D> cells(images.size()); //texel footprint of each padded image, page is stored in regions
+
+	for (uint32_t index : order)
+	{
+		const PendingImage& image = images[index];
+		uint32_t cellWidth = ((image.width + padding * 2) + alignment - 1) / alignment;
+		uint32_t cellHeight = ((image.height + padding * 2) + alignment - 1) / alignment;
+
+		if (cellWidth > pageUnitsX || cellHeight > pageUnitsY)
+			throw std::runtime_error("image too large for texture atlas page");
+
+		uint32_t x = 0;
+		uint32_t y = 0;
+		uint32_t page = 0;
+		for (; page < pages.size(); ++page)
+		{
+			if (pages[page].Pack(cellWidth, cellHeight, x, y))
+				break;
+		}
+
+		if (page == pages.size())
+		{
+			pages.emplace_back();
+			pages.back().Reset(pageUnitsX, pageUnitsY);
+			pages.back().Pack(cellWidth, cellHeight, x, y);
+		}
+
+		cells[index].offset = { (int32_t)(x * alignment), (int32_t)(y * alignment) };
+		cells[index].extent = { cellWidth * alignment, cellHeight * alignment };
+
+		AtlasRegion& region = regions[index];
+		region.layer = page;
+		region.x = x * alignment + padding;
+		region.y = y * alignment + padding;
+		region.width = image.width;
+		region.height = image.height;
+		region.uvMin = glm::vec2((float)region.x / pageWidth, (float)region.y / pageHeight);
+		region.uvMax = glm::vec2((float)(region.x + region.width) / pageWidth, (float)(region.y + region.height) / pageHeight);
+	}
+
+	pageCount = (uint32_t)pages.size();
+
+	size_t pageSize = (size_t)pageWidth * pageHeight * texelSize;
+	std::vector<uint8_t> texels(pageSize * pageCount, 0);
+
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		uint8_t* pPage = texels.data() + pageSize * regions[i].layer;
+		blitPadded(pPage, cells[i].offset.x, cells[i].offset.y, cells[i].extent.width, cells[i].extent.height, images[i]);
+	}
+
+	viewType = pageCount == 1 ? VK_IMAGE_VIEW_TYPE_2D : VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+	createTexture(pageWidth, pageHeight, pageCount, texels);
+}
+
+void TextureAtlas::blitPadded(uint8_t* pPage, uint32_t x, uint32_t y, uint32_t cellWidth, uint32_t cellHeight, const PendingImage& image)
+{
+	//fill the whole cell, the border replicates the nearest edge texel so filtering at the edges samples the image itself
+	for (uint32_t row = 0; row < cellHeight; ++row)
+	{
+		int64_t srcRow = std::clamp<int64_t>((int64_t)row - padding, 0, image.height - 1);
+		uint8_t* pDst = pPage + ((size_t)(y + row) * pageWidth + x) * texelSize;
+		const uint8_t* pSrc = image.pixels.data() + (size_t)srcRow * image.width * texelSize;
+
+		for (uint32_t col = 0; col < cellWidth; ++col)
+		{
+			int64_t srcCol = std::clamp<int64_t>((int64_t)col - padding, 0, image.width - 1);
+			memcpy(pDst + (size_t)col * texelSize, pSrc + (size_t)srcCol * texelSize, texelSize);
+		}
+	}
+}
+
+void TextureAtlas::createTexture(uint32_t width, uint32_t height, uint32_t layers, const std::vector<uint8_t>& texels)
+{
+	pTexture = new Texture2D(pDevice);
+	pTexture->CreateArray(width, height, layers, format, VK_IMAGE_USAGE_SAMPLED_BIT);
+	pTexture->Update((void*)texels.data());
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = pTexture->GetImage();
+	viewInfo.viewType = viewType;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = layers;
+
+	view = pDevice->GetImageViewCache()->Acquire(viewInfo);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "includes.h"
+
+class GraphicsDevice;
+class Texture2D;
+
+//where an image added to a TextureAtlas ended up
+struct AtlasRegion
+{
+	uint32_t layer; //array layer of the atlas texture
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+
+	glm::vec2 uvMin;
+	glm::vec2 uvMax;
+};
+
+//bottom-left skyline rectangle packer. coordinates are in whatever unit the caller packs in
+class SkylinePacker
+{
+public:
+	SkylinePacker();
+	~SkylinePacker();
+
+	void Reset(uint32_t width, uint32_t height);
+	bool Pack(uint32_t width, uint32_t height, uint32_t& outX, uint32_t& outY);
+
+	float GetOccupancy() const;
+private:
+	struct SkylineNode
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+	};
+
+	std::vector<SkylineNode> skyline;
+	uint32_t width;
+	uint32_t height;
+	uint64_t usedArea;
+
+	bool fits(size_t nodeIndex, uint32_t width, uint32_t height, uint32_t& outY) const;
+	void addLevel(size_t nodeIndex, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+};
+
+//packs lots of small images into as few texture pages as possible so they can be drawn with a single descriptor.
+//pages become layers of one texture array. images that all share the same size skip packing entirely and get one layer each
+class TextureAtlas
+{
+public:
+	TextureAtlas(GraphicsDevice* pDevice);
+	~TextureAtlas();
+
+	void SetPageSize(uint32_t width, uint32_t height);
+	void SetPadding(uint32_t padding); //texels of extruded border around each image
+	void SetMipLevels(uint32_t mipLevels); //number of mips the atlas has to survive without bleeding
+	void SetFormat(VkFormat format);
+
+	uint32_t AddImage(uint32_t width, uint32_t height, const void* pPixels); //returns handle used with GetRegion
+	void Build();
+
+	AtlasRegion GetRegion(uint32_t handle) const;
+	Texture2D* GetTexture() const;
+	VkImageView GetView() const;
+	VkImageViewType GetViewType() const;
+	uint32_t GetPageCount() const;
+
+	void Destroy();
+private:
+	struct PendingImage
+	{
+		uint32_t width;
+		uint32_t height;
+		std::vector<uint8_t> pixels;
+	};
+
+	GraphicsDevice* pDevice;
+	VkDevice GPU;
+
+	std::vector<PendingImage> images;
+	std::vector<AtlasRegion> regions;
+
+	Texture2D* pTexture;
+	VkImageView view;
+	VkImageViewType viewType;
+
+	uint32_t pageWidth;
+	uint32_t pageHeight;
+	uint32_t pageCount;
+	uint32_t padding;
+	uint32_t mipLevels;
+	VkFormat format;
+	uint32_t texelSize;
+
+	bool built;
+
+	bool imagesShareSize() const;
+	void buildArray();
+	void buildAtlas();
+	void blitPadded(uint8_t* pPage, uint32_t x, uint32_t y, uint32_t cellWidth, uint32_t cellHeight, const PendingImage& image);
+	void createTexture(uint32_t width, uint32_t height, uint32_t layers, const std::vector<uint8_t>& texels);
+};
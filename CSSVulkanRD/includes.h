@@ -22,4 +22,11 @@
 typedef uint32_t uint32;
 #define VULKAN_CALL(x) if (x != VK_SUCCESS) {throw std::runtime_error("Vulkan API Call Failed!"); }
 #define VULKAN_CALL_ERROR(x,error_msg) if (x != VK_SUCCESS) {throw std::runtime_error(error_msg); }
-#define THREAD_LOCK(mutexObj) {std::lock_guard<std::mutex> _threadLockObj(mutexObj);}
\ No newline at end of file
+#define THREAD_LOCK(mutexObj) {std::lock_guard<std::mutex> _threadLockObj(mutexObj);}
+
+//boost style hash mixing, used by the object caches to key on create info contents
+template<typename T>
+inline void HashCombine(size_t& seed, const T& value)
+{
+    seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
\ No newline at end of file
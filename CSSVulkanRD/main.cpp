@@ -11,8 +11,9 @@
 #include "GraphicsDevice.h"
 #include <glm/gtc/matrix_transform.hpp>
 #include "DeviceContext.h"
-#include <Windows.h>
 #include "Shader.h"
+#include "JobSystem.h"
+#include "PresentationController.h"
 
 const std::vector<VertexPositionColor> vertices = {
     {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}},
@@ -25,6 +26,9 @@ const std::vector<VertexPositionColor> vertices = {
     0, 1, 2, 2, 3, 0
     };
 
+static VkPresentModeKHR presentModeOption = VK_PRESENT_MODE_MAILBOX_KHR;
+static double targetFrameRateOption = 0.0;
+
 struct WorldViewProjection
 {
     glm::mat4 world;
@@ -39,6 +43,7 @@ public:
     virtual void Update() override;
     virtual void Render() override;
     virtual void DestroyResources()override;
+    virtual void RecordBatchJob(VkCommandBuffer cmd, VkExtent2D extent) override;
 
 
 private:
@@ -52,13 +57,56 @@ private:
 
 
 
-int main() {
+int main(int argc, char** argv) {
     //GraphicsDevice* pApp = new GraphicsDevice();
 
+    bool headless = false;
+    uint32_t headlessFrames = 600;
+    bool batch = false;
+    uint32_t batchJobs = 256;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--benchmark-jobs") == 0)
+        {
+            RunJobSystemBenchmark();
+            return EXIT_SUCCESS;
+        }
+        if (strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc) //fifo, relaxed, mailbox, immediate
+        {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "fifo") == 0) presentModeOption = VK_PRESENT_MODE_FIFO_KHR;
+            else if (strcmp(mode, "relaxed") == 0) presentModeOption = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+            else if (strcmp(mode, "mailbox") == 0) presentModeOption = VK_PRESENT_MODE_MAILBOX_KHR;
+            else if (strcmp(mode, "immediate") == 0) presentModeOption = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        }
+        if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+        {
+            targetFrameRateOption = atof(argv[++i]);
+        }
+        if (strcmp(argv[i], "--headless") == 0) //--headless [frames], renders offscreen, works on software icds like lavapipe
+        {
+            headless = true;
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+                headlessFrames = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        if (strcmp(argv[i], "--batch") == 0) //--batch [jobs], offline throughput through BatchRenderer, no window either
+        {
+            batch = true;
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+                batchJobs = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+    }
+
     app* pApp = new app();
 
     try {
-        pApp->Run();
+        if (batch)
+            pApp->RunBatch(800, 600, batchJobs);
+        else if (headless)
+            pApp->RunHeadless(800, 600, headlessFrames);
+        else
+            pApp->Run();
     }
     catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
@@ -70,6 +118,9 @@ int main() {
 
 void app::Initialize()
 {
+    pGraphics->SetPresentMode(presentModeOption);
+    pGraphics->GetPresentationController()->SetTargetFrameRate(targetFrameRateOption);
+
     shader = new Shader(pGraphics->GetGPU());
     shader->LoadShader("shaders\\vs.spv", "main", VK_SHADER_STAGE_VERTEX_BIT);
     shader->LoadShader("shaders\\ps.spv", "main", VK_SHADER_STAGE_FRAGMENT_BIT);
@@ -102,7 +153,7 @@ void app::Initialize()
     memcpy(gpu_mem, &wvp, sizeof(WorldViewProjection));
     cbWVP->UnMap();
 
-    Pipeline = new PipelineState(pGraphics->GetGPU(), pGraphics->GetSwapchainFramebufferCount());
+    Pipeline = new PipelineState(pGraphics, pGraphics->GetSwapchainFramebufferCount());
 
     auto swapExt = pGraphics->GetSwapchainExtent();
     VkViewport viewport{};
@@ -177,7 +228,6 @@ void app::Initialize()
     Pipeline->SetPrimitiveTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
     Pipeline->SetPrimitiveRestartEnable(VK_FALSE);
     Pipeline->SetRenderPass(pGraphics->GetRenderPass());
-    Pipeline->SetDescriptorPool(pGraphics->GetDescriptorPool());
     Pipeline->SetShader(shader);
 
     VkDescriptorSetLayoutBinding wvpBinding{};
@@ -211,22 +261,42 @@ void app::Render()
     vkCmdBindVertexBuffers(cmd, 0, 1,binding, offsets);
     vkCmdBindIndexBuffer(cmd, IndexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT16);
 
-    pGraphics->GetPipelineState()->UpdateUniformBufferDescriptor(fIndex, 0, cbWVP->GetBuffer(), 0, sizeof(WorldViewProjection));
+    PipelineState* pState = pGraphics->GetBoundPipelineState();
+    if (pState)
+    {
+        pState->UpdateUniformBufferDescriptor(fIndex, 0, cbWVP->GetBuffer(), 0, sizeof(WorldViewProjection));
 
-    VkDescriptorSet currentDescriptor = pGraphics->GetPipelineState()->GetDescriptorSet(fIndex);
-    vkCmdBindDescriptorSets(cmd,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pGraphics->GetPipelineState()->GetPipelineLayout(), 0, 1, &currentDescriptor, 0, nullptr);
+        VkDescriptorSet currentDescriptor = pState->GetDescriptorSet(fIndex);
+        vkCmdBindDescriptorSets(cmd,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pState->GetPipelineLayout(), pState->GetDescriptorSetIndex(), 1, &currentDescriptor, 0, nullptr);
 
-    vkCmdDrawIndexed(cmd, 6, 1, 0, 0, 0);
+        vkCmdDrawIndexed(cmd, 6, 1, 0, 0, 0);
+    }
 
     pGraphics->EndRenderPass(); //begin and end pass is the process of recording command buffer
 
     pGraphics->DrawFrame(); //submits, executes command buffers and displays frame
+}
 
-    Sleep(13);
+void app::RecordBatchJob(VkCommandBuffer cmd, VkExtent2D extent)
+{
+    //same quad as Render, every job reads descriptor set 0 so repeated writes are skipped while earlier jobs are in flight
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline->GetPipeline());
+
+    VkDeviceSize offsets[] = { 0 };
+    VkBuffer binding[] = { VertexBuffer->GetBuffer() };
+    vkCmdBindVertexBuffers(cmd, 0, 1, binding, offsets);
+    vkCmdBindIndexBuffer(cmd, IndexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT16);
+
+    Pipeline->UpdateUniformBufferDescriptor(0, 0, cbWVP->GetBuffer(), 0, sizeof(WorldViewProjection));
+    VkDescriptorSet descriptor = Pipeline->GetDescriptorSet(0);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline->GetPipelineLayout(), Pipeline->GetDescriptorSetIndex(), 1, &descriptor, 0, nullptr);
+
+    vkCmdDrawIndexed(cmd, 6, 1, 0, 0, 0);
 }
 
 void app::DestroyResources()
 {
+    Pipeline->Destroy();
 }
\ No newline at end of file
@@ -0,0 +1,18 @@
+//bindless resource table, set 0. #include it (glslc resolves includes) from shaders whose PipelineState has
+//SetBindlessTable, the pipeline's own bindings then live in set 1. binding numbers match BindlessResourceTable.h
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform texture2D bindlessImages[];
+layout(set = 0, binding = 1) uniform sampler bindlessSamplers[];
+layout(set = 0, binding = 2) buffer BindlessBuffer
+{
+    uint words[];
+} bindlessBuffers[];
+
+//indices come from a push constant or per instance data. wrap them in nonuniformEXT whenever they can differ
+//within a draw (instance data, anything read from a buffer), push constants are uniform and don't need it
+#define BINDLESS_TEXTURE(imageIndex, samplerIndex) \
+    sampler2D(bindlessImages[nonuniformEXT(imageIndex)], bindlessSamplers[nonuniformEXT(samplerIndex)])
+
+#define BINDLESS_LOAD(bufferIndex, wordOffset) \
+    bindlessBuffers[nonuniformEXT(bufferIndex)].words[wordOffset]